@@ -1,16 +1,22 @@
+#ifndef CLUSTER_CENTROIDS_H
+#define CLUSTER_CENTROIDS_H
+
 #include<vector>
 #include<algorithm>
 #include<cstdint>
 #include<iostream>
 #include "./k_means_pp.h"
+#include "../../../inc/resampler.h"
 
-class ClusterCentroids{
+class ClusterCentroids : public Resampler{
     public:
         ClusterCentroids(const uint32_t max_iters, const float tolerance) :max_iters_(max_iters), tolerance_(tolerance){}
         ~ClusterCentroids() = default;
-        std::vector<std::vector<float>> fit_resample(std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
     
     private:
         const uint32_t max_iters_;
         const float tolerance_;
-};
\ No newline at end of file
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef K_MEANS_PP_H
+#define K_MEANS_PP_H
+
 #include <cmath>    // sqrt
 #include <vector>
 #include <limits>   // std::numeric_limits
@@ -5,6 +8,8 @@
 #include <random>   // std::random_device, std::mt19937 gen(), std::uniform_real_distribution<>;
 #include <limits>   // std::numeric_limits<float>::max();
 #include<iostream>
+#include "../../../inc/distance_kernel.h"
+#include "../../../inc/weighted_sampler.h"
 
 class KMeansPP
 {
@@ -27,5 +32,7 @@ class KMeansPP
         std::unique_ptr<std::vector<std::vector<float>>> res_set_;
         std::vector<std::vector<float>> centroids_;  
         void gen_init_centroids(uint32_t n_clusters);
-        uint32_t rw_selection(std::vector<float> fitnesses);
+        uint32_t rw_selection(const std::vector<float> &fitnesses);
 };
+
+#endif
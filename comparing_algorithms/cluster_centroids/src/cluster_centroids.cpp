@@ -1,6 +1,6 @@
 #include "../inc/cluster_centroids.h"
 
-std::vector<std::vector<float>> ClusterCentroids::fit_resample(std::vector<std::vector<float>> &tra_set, const uint32_t n_classes)
+std::vector<std::vector<float>> ClusterCentroids::fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes)
 {
     const uint32_t label_idx = tra_set[0].size() - 1;
     std::vector<std::vector<float>> res_set = tra_set; // resample set
@@ -1,36 +1,18 @@
 #include "../inc/k_means_pp.h"
 
+// Over every column, the label included, like the centroids
 static inline float euclidean_dist(std::vector<float> &src, std::vector<float> &dst)
 {
-    const uint32_t n_dim = src.size();
-    float squ_dist = 0;
-
-    for(uint32_t dim_idx = 0; dim_idx < n_dim; dim_idx++)
-    {
-        float diff = src[dim_idx] - dst[dim_idx];
-        squ_dist += diff * diff;
-    }
-
-    return sqrt(squ_dist);
+    return sqrt(SquareDistance(src.data(), dst.data(), src.size()));
 }
 
-uint32_t KMeansPP::rw_selection(std::vector<float> fitnesses)
+uint32_t KMeansPP::rw_selection(const std::vector<float> &fitnesses)
 {
-    float total_fitness = std::accumulate(fitnesses.begin(), fitnesses.end(), 0.f);
-
     std::random_device rd;
     std::mt19937 gen(rd());
-    std::uniform_real_distribution<> distrib(0.0, total_fitness);
 
-    float random_value = distrib(gen);
-    for(uint32_t fitness_idx = 0; fitness_idx < fitnesses.size(); fitness_idx++){
-        random_value -= fitnesses[fitness_idx];
-        if(random_value <= 0.f){
-            return fitness_idx;
-        }
-    }
-
-    return fitnesses.size() - 1;
+    WeightedSampler sampler(fitnesses);
+    return sampler.Sample(gen);
 }
 
 void KMeansPP::gen_init_centroids(uint32_t n_clusters)
@@ -52,14 +34,12 @@ void KMeansPP::gen_init_centroids(uint32_t n_clusters)
     std::vector<uint32_t> init_centroids_idx(n_clusters); 
     init_centroids_idx[0] = distrib(gen); // Random select first centroid
     
+    // The fitness of a row sums its distances to the known centroids, so only the newest one is added per round
     std::vector<float> fitnesses(res_set_->size(), 0.f);
     for(uint32_t centroid_idx = 1; centroid_idx < n_clusters; centroid_idx++){
-        fitnesses.assign(res_set_->size(), 0.f);
+        uint32_t dst_idx = init_centroids_idx[centroid_idx - 1];
         for(uint32_t data_idx = 0; data_idx < res_set_->size();data_idx++){
-            for(uint32_t known_centroid_idx = 0; known_centroid_idx < centroid_idx; known_centroid_idx++){
-                uint32_t dst_idx = init_centroids_idx[known_centroid_idx];
-                fitnesses[data_idx] += dist_mat[data_idx][dst_idx];   
-            }
+            fitnesses[data_idx] += dist_mat[data_idx][dst_idx];
         }
 
         uint32_t selected_idx = rw_selection(fitnesses);
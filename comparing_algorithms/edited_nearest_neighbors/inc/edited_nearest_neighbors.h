@@ -9,26 +9,57 @@
 #include <utility>      // std::pair
 #include <iostream>     // std::cerr, std::endl
 #include <algorithm>    // std::max_element, std::distance, std::numeric_limits
+#include "../../../inc/resampler.h" // Resampler
+#include "../../../inc/distance_kernel.h" // DistancePanels
 
+#define ENN_MAX_PASSES      100 // Passes of ENN_REPEATED when every pass still removes rows
+#define ENN_SPARE_NEIGHBORS 8   // Neighbors searched beyond k for the multi-pass variants, so that most lists outlast
+                                // the removals of several passes without a new search
 
-class EditedNearestNeighbors{
+// Editing passes of fit_resample, each an ENN pass over the rows kept by the passes before, whose minority class
+// is not edited
+typedef enum ENNVariant{
+    ENN_SINGLE,   // one pass with k neighbors
+    ENN_REPEATED, // Repeated ENN: passes with k neighbors until one removes nothing, at most ENN_MAX_PASSES
+    ENN_ALL_KNN,  // AllKNN: one pass with every number of neighbors from 1 to k
+}ENNVariant;
+
+class EditedNearestNeighbors : public Resampler{
     public:
         EditedNearestNeighbors(const uint32_t k = 3) : k_(k) 
         {
             n_classes_ = 0;
             res_set_   = nullptr;
-            dist_mat_  = nullptr;
+            variant_   = ENN_SINGLE;
         }
         ~EditedNearestNeighbors() = default; // unique_ptr will handle memory cleanup
-        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
+        bool uses_distances(void) const override {return true;}
+
+        // ENN_REPEATED and ENN_ALL_KNN search exactly even under NEIGHBOR_SEARCH_HNSW, since their lists are repaired
+        // by exact searches between passes
+        void set_variant(const ENNVariant variant)
+        {
+            variant_ = variant;
+        }
 
     private:
         const uint32_t k_;
         uint32_t n_classes_;
         uint32_t label_idx_;
+        ENNVariant variant_;
         std::unique_ptr<std::vector<std::vector<float>>> res_set_;
-        std::unique_ptr<std::vector<std::vector<std::pair<uint32_t, float>>>> dist_mat_;
-        bool is_noise(const uint32_t src_idx);
+
+        // Nearest (distance, row) of every row for the multi-pass variants, searched once up to the largest k and
+        // repaired lazily: a pass drops the removed rows from the lists it reads and searches a list again only
+        // when fewer than k rows are left in it
+        std::vector<std::vector<std::pair<float, uint32_t>>> knn_lists_;
+        std::unique_ptr<DistancePanels> panels_; // distances of the searches without dist_cache_
+
+        bool is_noise(const uint32_t src_idx, const std::vector<uint32_t> &local_class_cnts) const;
+        uint32_t find_minority_class(const std::vector<bool> &is_kept) const;
+        void search_neighbors(const uint32_t src_idx, const std::vector<bool> &is_kept, std::vector<float> &square_dists);
+        uint32_t edit_pass(const uint32_t k, std::vector<bool> &is_kept);
 };
 
 #endif
\ No newline at end of file
@@ -1,30 +1,7 @@
 #include "../inc/edited_nearest_neighbors.h"
 
-static inline float euclidean_dist(const std::vector<float> &src, const std::vector<float> &dst)
+bool EditedNearestNeighbors::is_noise(const uint32_t src_idx, const std::vector<uint32_t> &local_class_cnts) const
 {
-    float square_distance = 0;
-    
-    // last column stores label
-    for(uint32_t feature_idx = 0; feature_idx < src.size() - 1; feature_idx++){
-        float diff = src[feature_idx] - dst[feature_idx];
-        square_distance += diff * diff;
-    }
-    return sqrt(square_distance);
-}
-
-bool EditedNearestNeighbors::is_noise(const uint32_t src_idx)
-{
-    std::partial_sort((*dist_mat_)[src_idx].begin(), (*dist_mat_)[src_idx].begin() + k_, (*dist_mat_)[src_idx].end(), 
-                        [](const std::pair<uint32_t, float> &a, const std::pair<uint32_t, float> &b)
-                            {return a.second < b.second;}); // acessing the k nearest neighbors
-    
-    std::vector<uint32_t> local_class_cnts(n_classes_ + 1, 0);
-    for(uint32_t k = 0; k < 3; k++){
-        uint32_t nn_idx   = (*dist_mat_)[src_idx][k].first;
-        uint32_t nn_label = (*res_set_)[nn_idx][label_idx_];
-        local_class_cnts[nn_label]++;
-    }
-
     auto max_it = std::max_element(local_class_cnts.begin() + 1, local_class_cnts.end());
     uint32_t local_maj_label = std::distance(local_class_cnts.begin(), max_it);
 
@@ -37,50 +14,150 @@ bool EditedNearestNeighbors::is_noise(const uint32_t src_idx)
     }
 }
 
+uint32_t EditedNearestNeighbors::find_minority_class(const std::vector<bool> &is_kept) const
+{
+    std::vector<uint32_t> class_cnts(n_classes_ + 1, 0);
+    for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){
+        if(is_kept[data_idx]){
+            uint32_t label = (*res_set_)[data_idx][label_idx_];
+            class_cnts[label]++;
+        }
+    }
+
+    auto min_it = std::min_element(class_cnts.begin() + 1, class_cnts.end());
+    return std::distance(class_cnts.begin(), min_it);
+}
+
+// Nearest kept rows of src_idx up to the largest k plus the spare ones, like the nearest queries of the kept rows
+void EditedNearestNeighbors::search_neighbors(const uint32_t src_idx, const std::vector<bool> &is_kept, std::vector<float> &square_dists)
+{
+    const uint32_t n_data = res_set_->size();
+    if(dist_cache_ == nullptr){
+        panels_->ComputeSquareDistances((*res_set_)[src_idx].data(), 0, n_data, square_dists.data());
+    }
+
+    std::vector<std::pair<float, uint32_t>> heap;
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        if(is_kept[data_idx] && data_idx != src_idx){
+            const float dist = (dist_cache_ != nullptr) ? dist_cache_->GetDistance(get_cache_idx(src_idx), get_cache_idx(data_idx)) :
+                                                            sqrt(square_dists[data_idx]);
+            PushNeighbor(heap, k_ + ENN_SPARE_NEIGHBORS, {dist, data_idx});
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    knn_lists_[src_idx].swap(heap);
+}
+
+// One ENN pass with k neighbors over the kept rows, which every row decides from the kept rows before the pass,
+// so the rows are split between threads; returns how many rows were removed
+uint32_t EditedNearestNeighbors::edit_pass(const uint32_t k, std::vector<bool> &is_kept)
+{
+    const uint32_t n_data = res_set_->size();
+    const uint32_t n_kept = std::count(is_kept.begin(), is_kept.end(), true);
+    const uint32_t minor_class_idx = find_minority_class(is_kept);
 
+    const uint32_t n_threads = std::max(n_threads_, 1u);
+    const uint32_t n_chunks = (n_data + KNN_QUERY_BLOCK_SIZE - 1) / KNN_QUERY_BLOCK_SIZE;
+    std::vector<uint8_t> is_noisy(n_data, 0); // bytes, so that threads write distinct elements
+    std::vector<std::vector<float>> thread_square_dists(n_threads, std::vector<float>((panels_ != nullptr) ? DistancePanels::GetBlockStride(0, n_data) : 0));
+    ParallelFor(n_chunks, n_threads, [&](const uint32_t chunk_idx, const uint32_t thread_idx){
+        std::vector<uint32_t> local_class_cnts(n_classes_ + 1);
+        const uint32_t chunk_end = std::min((chunk_idx + 1) * KNN_QUERY_BLOCK_SIZE, n_data);
+        for(uint32_t data_idx = chunk_idx * KNN_QUERY_BLOCK_SIZE; data_idx < chunk_end; data_idx++){
+            uint32_t label = (*res_set_)[data_idx][label_idx_];
+            if(!is_kept[data_idx] || label == minor_class_idx){ // the minority class is never edited
+                continue;
+            }
+
+            // The rows left in a list are the nearest kept rows, so it is searched again only when it holds fewer
+            // than k of them and some kept row is missing from it
+            std::vector<std::pair<float, uint32_t>> &neighbors = knn_lists_[data_idx];
+            neighbors.erase(std::remove_if(neighbors.begin(), neighbors.end(),
+                                            [&is_kept](const std::pair<float, uint32_t> &nn){return !is_kept[nn.second];}),
+                            neighbors.end());
+            if(neighbors.size() < std::min(k, n_kept - 1)){
+                search_neighbors(data_idx, is_kept, thread_square_dists[thread_idx]);
+            }
+
+            std::fill(local_class_cnts.begin(), local_class_cnts.end(), 0);
+            for(uint32_t rank = 0; rank < std::min(k, (uint32_t)neighbors.size()); rank++){
+                local_class_cnts[(uint32_t)(*res_set_)[neighbors[rank].second][label_idx_]]++;
+            }
+            is_noisy[data_idx] = is_noise(data_idx, local_class_cnts);
+        }
+    });
+
+    uint32_t n_removed = 0;
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        if(is_noisy[data_idx]){
+            is_kept[data_idx] = false;
+            n_removed++;
+        }
+    }
+
+    return n_removed;
+}
 
 std::vector<std::vector<float>> EditedNearestNeighbors::fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes)
 {
     this->label_idx_ = tra_set[0].size() - 1; // assuming last column is label
     this->n_classes_ = n_classes;
     res_set_ = std::make_unique<std::vector<std::vector<float>>>(tra_set); // resampled_set
-     
-    std::vector<uint32_t> class_cnts(n_classes + 1, 0); 
-    for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){   
-        uint32_t label = (*res_set_)[data_idx][label_idx_];
-        class_cnts[label]++;
-    }
 
-    this->dist_mat_ = std::make_unique<std::vector<std::vector<std::pair<uint32_t, float>>>>(
-        res_set_->size(), 
-        std::vector<std::pair<uint32_t, float>>(res_set_->size(), {0, 0.f})
-    );
-
-    for(uint32_t src_idx = 0; src_idx < (*res_set_).size(); src_idx++){
-        (*dist_mat_)[src_idx][src_idx] = {src_idx, std::numeric_limits<float>::max()};
-        for(uint32_t dst_idx = src_idx + 1; dst_idx < (*res_set_).size(); dst_idx++){
-            float distance = euclidean_dist((*res_set_)[src_idx], (*res_set_)[dst_idx]);
-            (*dist_mat_)[src_idx][dst_idx] = {dst_idx, distance};
-            (*dist_mat_)[dst_idx][src_idx] = {src_idx, distance};
-        }
-    }
+    check_distance_cache(res_set_->size());
 
-    auto min_it = std::min_element(class_cnts.begin() + 1, class_cnts.end());
-    uint32_t minor_class_idx = std::distance(class_cnts.begin(), min_it);
+    std::vector<bool> is_kept((*res_set_).size(), true);
+    const uint32_t minor_class_idx = find_minority_class(is_kept);
 
-    std::vector<bool> is_removed((*res_set_).size(), false);
+    // the minority class is never edited, so its samples need no neighbors; the multi-pass variants search every
+    // row, since the minority class of a later pass may differ
+    const uint32_t max_k = (variant_ == ENN_SINGLE) ? k_ : k_ + ENN_SPARE_NEIGHBORS;
+    std::vector<uint32_t> ks((*res_set_).size(), 0);
     for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){
         uint32_t label = (*res_set_)[data_idx][label_idx_];
-        if(label != minor_class_idx && is_noise(data_idx)){
-            is_removed[data_idx] = true;
+        ks[data_idx] = (label != minor_class_idx || variant_ != ENN_SINGLE) ? max_k : 0;
+    }
+    // the lists of the multi-pass variants are repaired by exact searches, so they start exact as well
+    const NeighborLists knn = find_k_nearest_neighbors(*res_set_, ks, cache_idxes_, (variant_ == ENN_SINGLE) ? 1 : n_threads_,
+                                                       variant_ != ENN_SINGLE);
+
+    if(variant_ == ENN_SINGLE){
+        std::vector<uint32_t> local_class_cnts(n_classes_ + 1);
+        for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){
+            uint32_t label = (*res_set_)[data_idx][label_idx_];
+            if(label != minor_class_idx){
+                std::fill(local_class_cnts.begin(), local_class_cnts.end(), 0);
+                for(uint32_t idx = knn.offsets[data_idx]; idx < knn.offsets[data_idx + 1]; idx++){
+                    local_class_cnts[(uint32_t)(*res_set_)[knn.idxes[idx]][label_idx_]]++;
+                }
+                is_kept[data_idx] = !is_noise(data_idx, local_class_cnts);
+            }
         }
     }
+    else{
+        knn_lists_.assign(res_set_->size(), std::vector<std::pair<float, uint32_t>>());
+        for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){
+            for(uint32_t idx = knn.offsets[data_idx]; idx < knn.offsets[data_idx + 1]; idx++){
+                knn_lists_[data_idx].emplace_back(knn.dists[idx], knn.idxes[idx]);
+            }
+        }
+        if(dist_cache_ == nullptr){
+            panels_ = std::make_unique<DistancePanels>(*res_set_);
+        }
 
-    for(int data_idx = (*res_set_).size() - 1; data_idx >= 0; data_idx--){
-        if(is_removed[data_idx]){
-            (*res_set_).erase((*res_set_).begin() + data_idx);
+        if(variant_ == ENN_REPEATED){
+            for(uint32_t pass = 0; pass < ENN_MAX_PASSES && edit_pass(k_, is_kept) > 0; pass++);
+        }
+        else{
+            for(uint32_t k = 1; k <= k_; k++){
+                edit_pass(k, is_kept);
+            }
         }
+        std::vector<std::vector<std::pair<float, uint32_t>>>().swap(knn_lists_);
+        panels_.reset();
     }
 
+    CompactRows(*res_set_, is_kept);
+
     return *res_set_;
-}
\ No newline at end of file
+}
@@ -1,14 +1,19 @@
-#ifndef RANDOM_UNDER_SAMPLING_H
-#define RANDOM_UNDER_SAMPLING_H
+#ifndef ENTROPY_BASED_UNDERSAMPLING_APPROACH_H
+#define ENTROPY_BASED_UNDERSAMPLING_APPROACH_H
 
 #include <vector>    // std::vector
+#include <utility>   // std::pair
 #include <memory>    // std::unique_ptr
 #include <random>    // std::default_random_engine
 #include <chrono>    // std::chrono  
+#include <numeric>   // std::iota
 #include <algorithm> // shuffle
 #include <iostream>
+#include "../../../inc/resampler.h"
 
-class EntropyBasedUndersampling
+#define EUS_SPARE_NEIGHBORS 8 // Neighbors kept beyond k, so that most removals are repaired without a new search
+
+class EntropyBasedUndersampling : public Resampler
 {
     public:
         EntropyBasedUndersampling(const uint32_t k = 5) : k_(k)
@@ -16,7 +21,8 @@ class EntropyBasedUndersampling
             n_classes_ = 0;
         };
         ~EntropyBasedUndersampling() = default;
-        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
+        bool uses_distances(void) const override {return true;}
     
     private:
         const uint32_t k_;
@@ -29,16 +35,32 @@ class EntropyBasedUndersampling
         std::vector<float> lambda_entro_;           // lambda * log(lambda)
         std::vector<float> cla_lambda_entro_sum_;   // sum of lambda_entro for each class
         
-        std::vector<float> pi_; 
+        std::vector<float> pi_;                     // exp(delta), divided by exp_sum_ for the probability of a row
+        float exp_sum_;
         std::vector<float> eta_;
         
         std::vector<float> gamma_;
         std::vector<float> theta_;
         std::unique_ptr<std::vector<std::vector<float>>> res_set_; // resampled set
-        void compute_instance_wise_stc(std::vector<std::vector<uint32_t>> &intra_class_nns);
-        void compute_class_wise_stc();
-        void compute_instance_wise_diff();
-        void compute_class_wise_diff();
+        std::vector<uint32_t> tra_idxes_;                           // row of the distance cache of each resampled row
+
+        // The rows are removed from res_set_ once at the end; until then is_kept_ marks the rows left. Every kept row keeps
+        // its k_ + EUS_SPARE_NEIGHBORS nearest kept rows by (distance, row), so that removing a row only repairs the lists
+        // that held it, and a list is searched again when fewer than k_ rows are left in it.
+        std::vector<bool> is_kept_;
+        std::vector<std::vector<uint32_t>> class_rows_;                  // kept rows of every class by ascending row
+        std::vector<std::vector<std::pair<float, uint32_t>>> knn_lists_; // nearest (distance, row) of every kept row
+        std::vector<std::vector<uint32_t>> holders_;                     // rows whose list held a row when searched
+        uint32_t n_kept_;
+
+        float get_distance(const uint32_t src_idx, const uint32_t dst_idx) const;
+        void search_neighbors(const uint32_t data_idx);
+        void remove_instance(const uint32_t data_idx, std::vector<bool> &is_class_changed);
+        void compute_instance_wise_stc(const uint32_t data_idx);
+        void compute_class_wise_stc(const uint32_t class_idx);
+        void compute_instance_wise_diff(const uint32_t class_idx);
+        void compute_exp_sum(void);
+        void compute_class_wise_diff(const uint32_t class_idx);
 };
 
 #endif
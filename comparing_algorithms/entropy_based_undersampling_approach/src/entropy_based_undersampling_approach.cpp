@@ -1,176 +1,241 @@
 #include "../inc/entropy_based_undersampling_approach.h"
 
-inline float euclidean_dist(const std::vector<float> &src, const std::vector<float> &dst)
+float EntropyBasedUndersampling::get_distance(const uint32_t src_idx, const uint32_t dst_idx) const
 {
-    float square_distance = 0;
-
-    // the last column of vector stores the label
-    for(uint32_t feature_idx = 0; feature_idx < src.size() - 1; feature_idx++){
-        float diff = src[feature_idx] - dst[feature_idx];
-        square_distance += diff * diff;
-    }
-
-    return sqrt(square_distance);
+    return (dist_cache_ != nullptr) ? dist_cache_->GetDistance(tra_idxes_[src_idx], tra_idxes_[dst_idx]) :
+                                        EuclideanDistance((*res_set_)[src_idx], (*res_set_)[dst_idx]);
 }
 
-void EntropyBasedUndersampling::compute_class_wise_diff(void)
-{   
-    eta_.resize(n_classes_ + 1, 0.f);
-    for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
-        uint32_t label = (*res_set_)[data_idx][label_idx_];
-        eta_[label] += pi_[data_idx];
+// Nearest kept rows of a row by scanning all of them, like the nearest queries of the kept rows would find them
+void EntropyBasedUndersampling::search_neighbors(const uint32_t data_idx)
+{
+    std::vector<std::pair<float, uint32_t>> heap;
+    for(uint32_t nn_idx = 0; nn_idx < res_set_->size(); nn_idx++){
+        if(is_kept_[nn_idx] && nn_idx != data_idx){
+            PushNeighbor(heap, k_ + EUS_SPARE_NEIGHBORS, {get_distance(data_idx, nn_idx), nn_idx});
+        }
     }
+    std::sort_heap(heap.begin(), heap.end());
 
-    for(uint32_t class_idx = 1; class_idx <= n_classes_; class_idx++){
-        eta_[class_idx] /= class_cnts_[class_idx];
+    for(const std::pair<float, uint32_t> &neighbor : heap){
+        holders_[neighbor.second].push_back(data_idx);
     }
+    knn_lists_[data_idx].swap(heap);
 }
 
-void EntropyBasedUndersampling::compute_class_wise_stc()
+// Remove a row and repair the lists that held it among their k_ nearest rows; the classes whose statistics
+// changed are marked in is_class_changed
+void EntropyBasedUndersampling::remove_instance(const uint32_t data_idx, std::vector<bool> &is_class_changed)
 {
-    theta_.resize(n_classes_ + 1, 0.f);
+    const uint32_t label = (*res_set_)[data_idx][label_idx_];
+    is_kept_[data_idx] = false;
+    n_kept_--;
+    class_cnts_[label]--;
+    class_rows_[label].erase(std::lower_bound(class_rows_[label].begin(), class_rows_[label].end(), data_idx));
+    is_class_changed[label] = true;
+
+    for(const uint32_t holder_idx : holders_[data_idx]){
+        std::vector<std::pair<float, uint32_t>> &neighbors = knn_lists_[holder_idx];
+        auto neighbor = std::find_if(neighbors.begin(), neighbors.end(),
+                                        [data_idx](const std::pair<float, uint32_t> &nn){return nn.second == data_idx;});
+        if(!is_kept_[holder_idx] || neighbor == neighbors.end()){
+            continue;
+        }
 
-    cla_lambda_sum_.resize(n_classes_ + 1, 0.f);
-    lambda_entro_.resize(res_set_->size(), 0.f);
-    cla_lambda_entro_sum_.resize(n_classes_ + 1, 0.f);
-    for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
-        uint32_t label = (*res_set_)[data_idx][label_idx_];
-        cla_lambda_sum_[label] += lambda_[data_idx];
-        if(lambda_[data_idx] > 0.f){
-            lambda_entro_[data_idx] = lambda_[data_idx] * log(lambda_[data_idx]);
-            cla_lambda_entro_sum_[label] += lambda_entro_[data_idx];
-        }  
+        const uint32_t rank = neighbor - neighbors.begin();
+        neighbors.erase(neighbor);
+        if(rank < k_){ // the spare neighbors beyond k_ do not change lambda
+            // The rows left in a list are the nearest kept rows, so it is searched again only when it holds fewer
+            // than k_ of them and some kept row is missing from it
+            if(neighbors.size() < std::min(k_, n_kept_ - 1)){
+                search_neighbors(holder_idx);
+            }
+            compute_instance_wise_stc(holder_idx);
+            is_class_changed[(uint32_t)(*res_set_)[holder_idx][label_idx_]] = true;
+        }
     }
-    
-    for(uint32_t class_idx = 1; class_idx <= n_classes_; class_idx++){
-        theta_[class_idx] = -1.f * cla_lambda_entro_sum_[class_idx] / cla_lambda_sum_[class_idx] + log(cla_lambda_sum_[class_idx]);
-        theta_[class_idx] /= class_cnts_[class_idx];
+    std::vector<uint32_t>().swap(holders_[data_idx]);
+}
+
+void EntropyBasedUndersampling::compute_class_wise_diff(const uint32_t class_idx)
+{
+    eta_[class_idx] = 0.f;
+    for(const uint32_t data_idx : class_rows_[class_idx]){
+        eta_[class_idx] += pi_[data_idx] / exp_sum_;
     }
+    eta_[class_idx] /= class_cnts_[class_idx];
 }
-																
-void EntropyBasedUndersampling::compute_instance_wise_stc(std::vector<std::vector<uint32_t>> &intra_class_nns)
-{    
-    std::vector<std::vector<std::pair<uint32_t, float>>> dist_mat(res_set_->size(), std::vector<std::pair<uint32_t, float>>(res_set_->size(), {0, 0.f}));
-    for(uint32_t src_idx = 0; src_idx < res_set_->size(); src_idx++){
-        dist_mat[src_idx][src_idx] = {src_idx, std::numeric_limits<float>::max()};
-        for(uint32_t dst_idx = src_idx + 1; dst_idx < res_set_->size(); dst_idx++){
-            float dist = euclidean_dist((*res_set_)[src_idx], (*res_set_)[dst_idx]);
-            dist_mat[src_idx][dst_idx] = {dst_idx, dist};
-            dist_mat[dst_idx][src_idx] = {src_idx, dist};
-        }
+
+void EntropyBasedUndersampling::compute_class_wise_stc(const uint32_t class_idx)
+{
+    // summed by ascending row, so the sums do not depend on the order of the removals
+    cla_lambda_sum_[class_idx] = 0.f;
+    cla_lambda_entro_sum_[class_idx] = 0.f;
+    for(const uint32_t data_idx : class_rows_[class_idx]){
+        cla_lambda_sum_[class_idx] += lambda_[data_idx];
+        cla_lambda_entro_sum_[class_idx] += lambda_entro_[data_idx];
     }
-    
-    lambda_.resize(res_set_->size(), 0.f);
-    
-    intra_class_nns.clear();
-    intra_class_nns.resize(res_set_->size());
-    for(uint32_t src_idx = 0; src_idx < res_set_->size(); src_idx++){
-        uint32_t src_label = (*res_set_)[src_idx][label_idx_];
-
-        std::partial_sort(dist_mat[src_idx].begin(), dist_mat[src_idx].begin() + k_, dist_mat[src_idx].end(), 
-            [](const std::pair<uint32_t, float> &a, const std::pair<uint32_t, float> &b){return a.second < b.second;});
-
-        for(uint32_t k = 0; k < k_; k++){
-            uint32_t nn_idx   = dist_mat[src_idx][k].first;
-            uint32_t nn_label = (*res_set_)[nn_idx][label_idx_];
-
-            if(nn_label == src_label){
-                intra_class_nns[src_idx].emplace_back(nn_idx);
-                if(dist_mat[src_idx][k].second > 0.f){
-                    lambda_[src_idx] += (1.f / dist_mat[src_idx][k].second);
-                }
+
+    theta_[class_idx] = -1.f * cla_lambda_entro_sum_[class_idx] / cla_lambda_sum_[class_idx] + log(cla_lambda_sum_[class_idx]);
+    theta_[class_idx] /= class_cnts_[class_idx];
+}
+
+void EntropyBasedUndersampling::compute_instance_wise_stc(const uint32_t data_idx)
+{
+    const std::vector<std::pair<float, uint32_t>> &neighbors = knn_lists_[data_idx];
+    const uint32_t src_label = (*res_set_)[data_idx][label_idx_];
+
+    uint32_t n_intra_class_nns = 0;
+    lambda_[data_idx] = 0.f;
+    for(uint32_t k = 0; k < std::min(k_, (uint32_t)neighbors.size()); k++){
+        uint32_t nn_label = (*res_set_)[neighbors[k].second][label_idx_];
+        float nn_dist     = neighbors[k].first;
+
+        if(nn_label == src_label){
+            n_intra_class_nns++;
+            if(nn_dist > 0.f){
+                lambda_[data_idx] += (1.f / nn_dist);
             }
         }
+    }
 
-        if(intra_class_nns[src_idx].size() > 0){
-            lambda_[src_idx] /= intra_class_nns[src_idx].size();
-        }
+    if(n_intra_class_nns > 0){
+        lambda_[data_idx] /= n_intra_class_nns;
     }
+    lambda_entro_[data_idx] = (lambda_[data_idx] > 0.f) ? lambda_[data_idx] * log(lambda_[data_idx]) : 0.f;
 }
 
-void EntropyBasedUndersampling::compute_instance_wise_diff(void)
+void EntropyBasedUndersampling::compute_instance_wise_diff(const uint32_t class_idx)
 {
-    std::vector<std::vector<uint32_t>> intra_class_nns;
-    std::vector<float> class_lambda_sum;
-
-    compute_instance_wise_stc(intra_class_nns); // statistic (stc)
-    compute_class_wise_stc();
-
-    std::vector<float> delta(res_set_->size(), 0.f);
-    for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
+    for(const uint32_t data_idx : class_rows_[class_idx]){
         // L_i is the set including the instance i and its intra-class nearest neighbors
-        float l_i_lambda_sum       = lambda_[data_idx]; 
-        float l_i_lambda_entro_sum = lambda_entro_[data_idx]; 
-        
-        for(uint32_t k = 0; k < intra_class_nns[data_idx].size(); k++){
-            uint32_t intra_class_nn_idx = intra_class_nns[data_idx][k];
-            l_i_lambda_sum       += lambda_[intra_class_nn_idx];
-            l_i_lambda_entro_sum += lambda_entro_[intra_class_nn_idx];
+        float l_i_lambda_sum       = lambda_[data_idx];
+        float l_i_lambda_entro_sum = lambda_entro_[data_idx];
+
+        const std::vector<std::pair<float, uint32_t>> &neighbors = knn_lists_[data_idx];
+        uint32_t n_intra_class_nns = 0;
+        for(uint32_t k = 0; k < std::min(k_, (uint32_t)neighbors.size()); k++){
+            uint32_t intra_class_nn_idx = neighbors[k].second;
+            if((uint32_t)(*res_set_)[intra_class_nn_idx][label_idx_] == class_idx){
+                l_i_lambda_sum       += lambda_[intra_class_nn_idx];
+                l_i_lambda_entro_sum += lambda_entro_[intra_class_nn_idx];
+                n_intra_class_nns++;
+            }
         }
 
-        uint32_t label = (*res_set_)[data_idx][label_idx_];
-        float cla_lambda_sum_i       = cla_lambda_sum_[label] - l_i_lambda_sum; // exclude the instance i and its intra-class nearest neighbors
-        float cla_lambda_entro_sum_i = cla_lambda_entro_sum_[label] - l_i_lambda_entro_sum;
+        float cla_lambda_sum_i       = cla_lambda_sum_[class_idx] - l_i_lambda_sum; // exclude the instance i and its intra-class nearest neighbors
+        float cla_lambda_entro_sum_i = cla_lambda_entro_sum_[class_idx] - l_i_lambda_entro_sum;
         float theta_i = -1.f * cla_lambda_entro_sum_i / cla_lambda_sum_i + log(cla_lambda_sum_i);
+        float delta = 0.f;
         if(theta_i > 0.f){
-            theta_i /= (class_cnts_[label] - intra_class_nns[data_idx].size());
-            delta[data_idx] = theta_[label] * log(theta_[label] / theta_i);
+            theta_i /= (class_cnts_[class_idx] - n_intra_class_nns);
+            delta = theta_[class_idx] * log(theta_[class_idx] / theta_i);
         }
+        pi_[data_idx] = exp(delta);
     }
-    
-    float exp_sum = 0.f;
-    pi_.resize(res_set_->size(), 0.f);
-    for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
-        pi_[data_idx] = exp(delta[data_idx]);
-        exp_sum += pi_[data_idx];
-    }
-    
+}
+
+void EntropyBasedUndersampling::compute_exp_sum(void)
+{
+    exp_sum_ = 0.f;
     for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
-        pi_[data_idx] /= exp_sum;
+        if(is_kept_[data_idx]){
+            exp_sum_ += pi_[data_idx];
+        }
     }
 }
 
+// Removes the instance of least probability from every class until the class-wise diff of the class reaches the
+// largest one. Every statistic is the one of the kept rows, as if computed again after each removal, but a removal
+// only searches again the lists that ran short and only rescores the classes whose lambda changed.
 std::vector<std::vector<float>> EntropyBasedUndersampling::fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes)
 {
     this->n_classes_ = n_classes;
     this->label_idx_ = tra_set[0].size() - 1;
     res_set_ = std::make_unique<std::vector<std::vector<float>>>(tra_set);
+    const uint32_t n_data = res_set_->size();
 
-    class_cnts_.resize(n_classes_ + 1, 0);
-    for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
+    check_distance_cache(n_data);
+    tra_idxes_.resize(n_data);
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        tra_idxes_[data_idx] = get_cache_idx(data_idx);
+    }
+
+    class_cnts_.assign(n_classes_ + 1, 0);
+    class_rows_.assign(n_classes_ + 1, std::vector<uint32_t>());
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
         uint32_t label = (*res_set_)[data_idx][label_idx_];
         class_cnts_[label]++;
+        class_rows_[label].push_back(data_idx);
+    }
+    is_kept_.assign(n_data, true);
+    n_kept_ = n_data;
+
+    const std::vector<uint32_t> ks(n_data, k_ + EUS_SPARE_NEIGHBORS);
+    // exact even under NEIGHBOR_SEARCH_HNSW, since search_neighbors repairs the lists by exact scans
+    const NeighborLists knn = find_k_nearest_neighbors(*res_set_, ks, &tra_idxes_, n_threads_, true);
+    knn_lists_.assign(n_data, std::vector<std::pair<float, uint32_t>>());
+    holders_.assign(n_data, std::vector<uint32_t>());
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        for(uint32_t idx = knn.offsets[data_idx]; idx < knn.offsets[data_idx + 1]; idx++){
+            knn_lists_[data_idx].emplace_back(knn.dists[idx], knn.idxes[idx]);
+            holders_[knn.idxes[idx]].push_back(data_idx);
+        }
     }
 
-    compute_instance_wise_diff();
-    compute_class_wise_diff();
+    lambda_.assign(n_data, 0.f);
+    lambda_entro_.assign(n_data, 0.f);
+    pi_.assign(n_data, 0.f);
+    cla_lambda_sum_.assign(n_classes_ + 1, 0.f);
+    cla_lambda_entro_sum_.assign(n_classes_ + 1, 0.f);
+    theta_.assign(n_classes_ + 1, 0.f);
+    eta_.assign(n_classes_ + 1, 0.f);
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        compute_instance_wise_stc(data_idx); // statistic (stc)
+    }
+    for(uint32_t class_idx = 1; class_idx <= n_classes_; class_idx++){
+        compute_class_wise_stc(class_idx);
+        compute_instance_wise_diff(class_idx);
+    }
+    compute_exp_sum();
+    for(uint32_t class_idx = 1; class_idx <= n_classes_; class_idx++){
+        compute_class_wise_diff(class_idx);
+    }
 
     float max_eta = *std::max_element(eta_.begin() + 1, eta_.end());
+    std::vector<bool> is_class_changed(n_classes_ + 1);
     for(uint32_t class_idx = 1; class_idx <= n_classes_; class_idx++){
+        compute_class_wise_diff(class_idx); // the removals from the classes before changed exp_sum_
         float delta = max_eta - eta_[class_idx];
         while(delta > 0.f && class_cnts_[class_idx] > 1){
-            int min_idx_in_class = -1;
-            for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
-                uint32_t label = (*res_set_)[data_idx][label_idx_];
-                if(label == class_idx){
-                    if(pi_[data_idx] < pi_[min_idx_in_class] || min_idx_in_class == -1){
-                        min_idx_in_class = data_idx;
-                    }
+            // least probability, the first row among ties
+            uint32_t min_idx_in_class = class_rows_[class_idx][0];
+            for(const uint32_t data_idx : class_rows_[class_idx]){
+                if(pi_[data_idx] / exp_sum_ < pi_[min_idx_in_class] / exp_sum_){
+                    min_idx_in_class = data_idx;
+                }
+            }
+
+            is_class_changed.assign(n_classes_ + 1, false);
+            remove_instance(min_idx_in_class, is_class_changed);
+            for(uint32_t changed_class_idx = 1; changed_class_idx <= n_classes_; changed_class_idx++){
+                if(is_class_changed[changed_class_idx]){
+                    compute_class_wise_stc(changed_class_idx);
+                    compute_instance_wise_diff(changed_class_idx);
                 }
             }
-            class_cnts_[class_idx]--;
-            res_set_->erase(res_set_->begin() + min_idx_in_class);
-            compute_instance_wise_diff();
-            compute_class_wise_diff();
+            compute_exp_sum();
+            compute_class_wise_diff(class_idx);
             delta = max_eta - eta_[class_idx];
         }
     }
 
+    CompactRows(*res_set_, is_kept_);
     class_cnts_.assign(n_classes + 1, 0); // reset class counts
-    for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){   
+    for(uint32_t data_idx = 0; data_idx < (*res_set_).size(); data_idx++){
         uint32_t label = (*res_set_)[data_idx][label_idx_];
         class_cnts_[label]++;
     }
 
     return *res_set_;
-}
\ No newline at end of file
+}
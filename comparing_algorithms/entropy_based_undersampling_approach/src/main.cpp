@@ -22,7 +22,7 @@ int main(int argc, char *argv[])
     clock_gettime(CLOCK_MONOTONIC, &start_ns);
     EntropyBasedUndersampling EUS(5);
     std::vector<std::vector<float>> resampled_set = EUS.fit_resample(dataset.training_set, dataset.n_classes);
-    Validation k_fold_validation(resampled_set, dataset.testing_set, dataset.n_classes, dtc_params, false);
+    Validation k_fold_validation(resampled_set, dataset.testing_set, dataset.n_classes, dtc_params, false, GetNumThreads());
     clock_gettime(CLOCK_MONOTONIC, &end_ns);
     running_time_ms = (float)(end_ns.tv_sec - start_ns.tv_sec) * 1000 + 
                                 (float)(end_ns.tv_nsec - start_ns.tv_nsec) / 1000000;
@@ -8,13 +8,14 @@
 #include <algorithm> // shuffle
 #include <iostream>
 #include "../../../inc/decision_tree_classifier.h"
+#include "../../../inc/resampler.h"
 
-class InstanceHardnessThreshold
+class InstanceHardnessThreshold : public Resampler
 {
     public:
         InstanceHardnessThreshold(const struct decision_tree_parameter &dtc_params, const uint32_t folds = 5) :folds_(folds), dtc_params_(dtc_params){}
         ~InstanceHardnessThreshold() = default;
-        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
     private:
         const uint16_t folds_;
         const struct decision_tree_parameter &dtc_params_;
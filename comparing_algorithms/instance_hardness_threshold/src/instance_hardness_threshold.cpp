@@ -18,13 +18,14 @@ std::vector<std::vector<float>> InstanceHardnessThreshold::fit_resample(const st
             right += res_set.size() / folds_;
         }
 
-        sub_tra_set = res_set;
-        sub_tra_set.erase(sub_tra_set.begin() + left, sub_tra_set.begin() + right); // leave out a portion of the training set for validation
+        // leave out a portion of the training set for validation
+        sub_tra_set.assign(res_set.begin(), res_set.begin() + left);
+        sub_tra_set.insert(sub_tra_set.end(), res_set.begin() + right, res_set.end());
         
-        DecisionTreeClassifier dtc(sub_tra_set, n_classes, dtc_params_);
+        const DecisionTreeClassifier dtc(sub_tra_set, n_classes, dtc_params_);
         for(uint32_t data_idx = left; data_idx < right; data_idx++){
             uint32_t label = res_set[data_idx][label_idx];
-            std::vector<float> predict_prob = dtc.GetPredictProb(res_set[data_idx]);
+            const std::vector<float> &predict_prob = dtc.GetLeafPredictProb(res_set[data_idx]);
             instance_hardnesses[data_idx] = (1.f - predict_prob[label]);
         }
     }
@@ -57,11 +58,7 @@ std::vector<std::vector<float>> InstanceHardnessThreshold::fit_resample(const st
         }
     }
 
-    for(int data_idx = res_set.size() - 1; data_idx >= 0; data_idx--){
-        if(!is_preserved[data_idx]){
-            res_set.erase(res_set.begin() + data_idx);
-        }
-    }
+    CompactRows(res_set, is_preserved);
 
     class_cnts.assign(n_classes + 1, 0); // reset class counts
     for(uint32_t data_idx = 0; data_idx < res_set.size(); data_idx++){   
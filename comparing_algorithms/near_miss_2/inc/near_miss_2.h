@@ -1,5 +1,5 @@
-#ifndef RANDOM_UNDER_SAMPLING_H
-#define RANDOM_UNDER_SAMPLING_H
+#ifndef NEAR_MISS_2_H
+#define NEAR_MISS_2_H
 
 #include <cmath>
 #include <queue>
@@ -8,12 +8,14 @@
 #include <cstdint>
 #include <iostream>
 #include <algorithm>
+#include "../../../inc/resampler.h"
 
-class NearMiss2{
+class NearMiss2 : public Resampler{
     public:
         NearMiss2(const uint32_t k = 3) :k_(k){};
         ~NearMiss2() = default;
-        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
+        bool uses_distances(void) const override {return true;}
     private:
         const uint32_t k_;
 };  
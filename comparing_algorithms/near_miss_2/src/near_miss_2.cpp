@@ -1,32 +1,11 @@
 #include "../inc/near_miss_2.h"
 
-static float inline EuclideanDistance(const std::vector<float> &src, const std::vector<float> &dst)
-{
-    float square_distance = 0;
-    
-    // last column stores label
-    for(uint32_t feature_idx = 0; feature_idx < src.size() - 1; feature_idx++){
-        float diff = src[feature_idx] - dst[feature_idx];
-        square_distance += diff * diff;
-    }
-
-    return sqrt(square_distance);
-}
-
 std::vector<std::vector<float>> NearMiss2::fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes)
 {
     const uint32_t label_idx = tra_set[0].size() - 1;
     std::vector<std::vector<float>> res_set = tra_set; // resampled set
 
-    std::vector<std::vector<float>> dist_mat(res_set.size(), std::vector<float>(res_set.size(), -1.f));
-    for(uint32_t src_idx = 0; src_idx < res_set.size(); src_idx++){
-        dist_mat[src_idx][src_idx] = 0.f;
-        for(uint32_t dst_idx = src_idx + 1; dst_idx < res_set.size(); dst_idx++){
-            float distance = EuclideanDistance(res_set[src_idx], res_set[dst_idx]);
-            dist_mat[src_idx][dst_idx] = distance;
-            dist_mat[dst_idx][src_idx] = distance;
-        }
-    }
+    check_distance_cache(res_set.size());
 
     std::vector<uint32_t> class_cnts(n_classes + 1, 0);
     for(uint32_t data_idx = 0; data_idx < res_set.size(); data_idx++){
@@ -39,27 +18,30 @@ std::vector<std::vector<float>> NearMiss2::fit_resample(const std::vector<std::v
         dist_to_other_classes[class_idx].reserve(class_cnts[class_idx]);
     }
 
-    for(uint32_t src_idx = 0; src_idx < res_set.size(); src_idx++){
-        uint32_t src_label = res_set[src_idx][label_idx];
-        std::vector<float> neighbors;
-        neighbors.reserve(res_set.size() - class_cnts[src_label]);
-
-        for(uint32_t dst_idx = 0; dst_idx < res_set.size(); dst_idx++){
-            uint32_t dst_label = res_set[dst_idx][label_idx];
-            if(dst_label != src_label){
-                neighbors.emplace_back(dist_mat[dst_idx][src_idx]);
+    // average distance of every sample to its k farthest samples of the other classes, queried class by class
+    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+        std::vector<uint32_t> query_idxes, data_idxes;
+        query_idxes.reserve(class_cnts[class_idx]);
+        data_idxes.reserve(res_set.size() - class_cnts[class_idx]);
+        for(uint32_t data_idx = 0; data_idx < res_set.size(); data_idx++){
+            uint32_t label = res_set[data_idx][label_idx];
+            if(label == class_idx){
+                query_idxes.emplace_back(data_idx);
+            }
+            else{
+                data_idxes.emplace_back(data_idx);
             }
         }
 
-        std::partial_sort(neighbors.begin(), neighbors.begin() + k_, neighbors.end(), 
-            [](const float &a, const float &b){return a > b;}); // sort in descending order
-
-        float sum_dist = 0.f;
-        for(uint32_t k = 0; k < 3; k++){
-            sum_dist += neighbors[k];
+        const std::vector<uint32_t> ks(query_idxes.size(), k_);
+        const NeighborLists farthest = FindKFarthestNeighbors(res_set, query_idxes, data_idxes, ks, 1, dist_cache_, neighbor_search_, cache_idxes_);
+        for(uint32_t query_idx = 0; query_idx < query_idxes.size(); query_idx++){
+            float sum_dist = 0.f;
+            for(uint32_t k = 0; k < farthest.GetNumNeighbors(query_idx); k++){
+                sum_dist += farthest.dists[farthest.offsets[query_idx] + k];
+            }
+            dist_to_other_classes[class_idx].emplace_back(query_idxes[query_idx], sum_dist / farthest.GetNumNeighbors(query_idx));
         }
-    
-        dist_to_other_classes[src_label].emplace_back(src_idx, sum_dist / 3.f);
     }
 
     std::vector<bool> is_preserved(res_set.size(), false);
@@ -74,11 +56,7 @@ std::vector<std::vector<float>> NearMiss2::fit_resample(const std::vector<std::v
         }
     }
 
-    for(int data_idx = res_set.size() - 1; data_idx >= 0; data_idx--){
-        if(!is_preserved[data_idx]){
-            res_set.erase(res_set.begin() + data_idx);
-        }
-    }
+    CompactRows(res_set, is_preserved);
 
     class_cnts.assign(n_classes + 1, 0); // reset class counts
     for(uint32_t data_idx = 0; data_idx < res_set.size(); data_idx++){   
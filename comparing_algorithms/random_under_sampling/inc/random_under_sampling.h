@@ -8,13 +8,14 @@
 #include <chrono>       // std::chrono  
 #include <algorithm>    // shuffle
 #include <iostream>     // std::cerr, std::endl
+#include "../../../inc/resampler.h" // Resampler
 
-class RandomUnderSampler
+class RandomUnderSampler : public Resampler
 {
     public:
         RandomUnderSampler(){};
         ~RandomUnderSampler() = default;
-        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
 };
 
 #endif
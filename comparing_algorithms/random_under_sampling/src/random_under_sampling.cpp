@@ -35,11 +35,7 @@ std::vector<std::vector<float>> RandomUnderSampler::fit_resample(const std::vect
         }
     }
 
-    for(int data_idx = res_set.size() - 1; data_idx >= 0; data_idx--){
-        if(!is_preserved[data_idx]){
-            res_set.erase(res_set.begin() + data_idx);
-        }
-    }
+    CompactRows(res_set, is_preserved);
 
     class_cnts.assign(n_classes + 1, 0); // reset class counts
     for(uint32_t data_idx = 0; data_idx < res_set.size(); data_idx++){   
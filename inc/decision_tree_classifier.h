@@ -24,6 +24,13 @@ class DecisionTreeClassifier{
         // Use in the testing phase
         uint32_t GetPredictLabel(const std::vector<float> &testing_sample);
         std::vector<float> GetPredictProb(const std::vector<float> &testing_sample);
+        // Probabilities of the leaf reached by testing_sample, without copying; valid while the tree is alive
+        const std::vector<float> &GetLeafPredictProb(const std::vector<float> &testing_sample) const;
+
+        // Leaves are numbered 0..GetNumLeaves()-1, so predictions can be grouped by the leaf they come from
+        uint32_t GetNumLeaves(void) const {return leaves.size();};
+        uint32_t GetLeafIdx(const std::vector<float> &testing_sample) const;
+        const std::vector<float> &GetLeafPredictProb(const uint32_t leaf_idx) const {return leaves[leaf_idx]->predict_prob;};
     
     private:
         class SplitPoint{
@@ -38,12 +45,14 @@ class DecisionTreeClassifier{
                 TreeNode(const uint32_t n_classes)
                 {
                     split_point = {0, 0.f, 0.f};
+                    leaf_idx = 0;
                     predict_prob.resize(n_classes + 1, 0.f);
                     right_child = NULL;
                     left_child = NULL;
                 };
 
                 SplitPoint split_point;
+                uint32_t leaf_idx; // Position in leaves, meaningful only for leaf nodes
                 std::vector<float> predict_prob;
                 std::shared_ptr<TreeNode> right_child;
                 std::shared_ptr<TreeNode> left_child;
@@ -53,7 +62,9 @@ class DecisionTreeClassifier{
         const struct decision_tree_parameter dtc_param;
         
         std::shared_ptr<TreeNode> root;
+        std::vector<const TreeNode *> leaves;
 
+        const TreeNode *FindLeaf(const std::vector<float> &testing_sample) const;
         void CreateDecisionTree(const std::vector<std::vector<float>> &training_set);
         void FindBestSplitPoint(std::shared_ptr<TreeNode> node, const std::vector<std::vector<std::vector<float>>> &sorted_features, std::vector<bool> &is_existing_data);
         SplitPoint FindFeatureBestSplitPoint(const std::vector<std::vector<float>> &sorted_feature, const std::vector<bool> &is_existing_data);
@@ -0,0 +1,75 @@
+#ifndef DISTANCE_KERNEL_H
+#define DISTANCE_KERNEL_H
+
+#include <cfloat>    // FLT_EPSILON
+#include <vector>    // std::vector
+#include <cstdint>   // uint32_t
+#include <algorithm> // std::fill, std::copy, std::min
+
+#define DISTANCE_PANEL_WIDTH 16 // Rows transposed together, one AVX-512 or two AVX2 registers wide
+#define DISTANCE_QUERY_TILE  4  // Queries sharing each load of a panel in the approximate block kernel
+
+// Squared Euclidean distance between the first n_features values of src and dst, summed feature by feature.
+// This order defines the exact distance: every search and every kernel below reproduces it bit for bit.
+inline float SquareDistance(const float *src, const float *dst, const uint32_t n_features)
+{
+    float square_distance = 0;
+    for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+        float diff = src[feature_idx] - dst[feature_idx];
+        square_distance += diff * diff;
+    }
+
+    return square_distance;
+}
+
+// Feature columns of a dataset whose last column stores the label, transposed in panels of
+// DISTANCE_PANEL_WIDTH rows, so that vector instructions compute the distances of a query to a whole
+// panel at once without horizontal sums. The kernels use AVX-512 or AVX2 when the CPU supports them and
+// a scalar loop otherwise. The panels are immutable once built and can be read from several threads.
+class DistancePanels{
+    public:
+        DistancePanels(const std::vector<std::vector<float>> &dataset);
+        ~DistancePanels() = default;
+
+        uint32_t GetNumData(void) const
+        {
+            return n_data_;
+        }
+
+        // square_dists[j] = SquareDistance(query, row data_begin + j) for the rows of the panels from data_begin
+        // (a multiple of DISTANCE_PANEL_WIDTH) up to data_end, rounded up to whole panels
+        void ComputeSquareDistances(const float *query, const uint32_t data_begin, const uint32_t data_end, float *square_dists) const;
+        // block[(q - query_begin) * stride + j] ~ squared distance between rows q and data_begin + j, from
+        // ||q||^2 + ||d||^2 - 2 q.d with one fused multiply-add per feature and pair, where stride is
+        // data_end - data_begin rounded up to whole panels. GetErrorBound bounds the difference to SquareDistance.
+        void ComputeApproxSquareDistances(const uint32_t query_begin, const uint32_t query_end, const uint32_t data_begin,
+                                            const uint32_t data_end, float *block) const;
+
+        float GetErrorBound(const uint32_t src_idx, const uint32_t dst_idx) const
+        {
+            return error_scale_ * (square_norms_[src_idx] + square_norms_[dst_idx]);
+        }
+
+        static uint32_t GetBlockStride(const uint32_t data_begin, const uint32_t data_end)
+        {
+            return (data_end - data_begin + DISTANCE_PANEL_WIDTH - 1) / DISTANCE_PANEL_WIDTH * DISTANCE_PANEL_WIDTH;
+        }
+
+    private:
+        typedef void (*ExactKernel)(const float *query, const float *panels, const uint32_t n_panels, const uint32_t n_features,
+                                        float *square_dists);
+        typedef void (*ApproxKernel)(const float *queries[DISTANCE_QUERY_TILE], const float *query_norms, const uint32_t n_queries,
+                                        const float *panels, const float *square_norms, const uint32_t n_panels,
+                                        const uint32_t n_features, float *block, const uint32_t stride);
+
+        uint32_t n_data_;
+        uint32_t n_features_;
+        float error_scale_;                // rounding of both formulas relative to ||q||^2 + ||d||^2
+        std::vector<float> panels_;        // panel p holds feature f of row p * WIDTH + lane at [(p * n_features_ + f) * WIDTH + lane]
+        std::vector<float> rows_;          // n_data_ x n_features_, the queries of the block kernel
+        std::vector<float> square_norms_;  // n_data_ rounded up to whole panels, 0 for padding
+        ExactKernel exact_kernel_;
+        ApproxKernel approx_kernel_;
+};
+
+#endif // DISTANCE_KERNEL_H
@@ -0,0 +1,48 @@
+#ifndef DISTANCE_MATRIX_H
+#define DISTANCE_MATRIX_H
+
+#include <cmath>   // sqrt
+#include <vector>  // std::vector
+#include <cstdint> // uint32_t, uint64_t
+#include "../inc/thread_pool.h"
+#include "../inc/distance_kernel.h"
+
+// Euclidean distance between two rows whose last column stores the label
+inline float EuclideanDistance(const std::vector<float> &src, const std::vector<float> &dst)
+{
+    return sqrt(SquareDistance(src.data(), dst.data(), src.size() - 1)); // the last column of vector stores the label
+}
+
+// Euclidean distances between all rows of a dataset whose last column stores the label.
+// Only the upper triangle is stored, computed a panel of rows at a time (distance_kernel.h). The matrix is immutable once built, so a scheduler can compute it
+// once per training set and share it between resamplers running on different threads.
+class DistanceMatrix{
+    public:
+        DistanceMatrix(const std::vector<std::vector<float>> &dataset, const uint32_t n_threads = 1);
+        ~DistanceMatrix() = default;
+
+        uint32_t GetNumData(void) const
+        {
+            return n_data_;
+        }
+
+        float GetDistance(const uint32_t src_idx, const uint32_t dst_idx) const
+        {
+            if(src_idx == dst_idx){
+                return 0.f;
+            }
+            else if(src_idx < dst_idx){
+                return dists_[row_offsets_[src_idx] + dst_idx];
+            }
+            else{
+                return dists_[row_offsets_[dst_idx] + src_idx];
+            }
+        }
+
+    private:
+        uint32_t n_data_;
+        std::vector<uint64_t> row_offsets_; // dists_[row_offsets_[src_idx] + dst_idx] for src_idx < dst_idx
+        std::vector<float> dists_;
+};
+
+#endif // DISTANCE_MATRIX_H
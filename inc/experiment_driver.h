@@ -0,0 +1,90 @@
+#ifndef EXPERIMENT_DRIVER_H
+#define EXPERIMENT_DRIVER_H
+
+#include <ctime>      // timespec, clock_gettime
+#include <cmath>      // sqrt
+#include <string>
+#include <vector>
+#include <fstream>    // std::ofstream
+#include <iomanip>    // std::fixed, std::setprecision
+#include <functional> // std::function
+#include <algorithm>  // std::sort, std::lower_bound, std::upper_bound, std::find_if
+#include "../inc/validation.h"
+#include "../inc/thread_pool.h"
+#include "../inc/file_operations.h"
+
+#define NUM_METRICS 9
+#define NUM_POOLED_METRICS 8 // All metrics except the running time
+
+// Clock of the running time. The evaluations run n_threads at a time, each on one thread (a resampler keeps its default
+// single thread, see Resampler::set_num_threads), so the CPU time of that thread leaves out the time it waits for a core;
+// it is named in the CSV header, see METRIC_NAMES.
+#define EXPERIMENT_CLOCK CLOCK_THREAD_CPUTIME_ID
+
+// Rows of a dataset up to which the folds also share one DistanceMatrix of all its rows (8192 rows take 128 MiB),
+// which the resamplers read beyond their nearest queries; larger datasets only share the O(N * k) NeighborGraph.
+#define EXPERIMENT_MATRIX_MAX_DATA 8192
+#define BOOTSTRAP_RESAMPLES 1000
+#define BOOTSTRAP_CONFIDENCE_LEVEL 0.95
+#define BOOTSTRAP_SEED 0 // Seed of the first bootstrap resample, so that the intervals of a result file can be reproduced
+
+// Same order as the lines printed by every main.cpp, whose running time is the wall clock of one process instead
+static const char *const METRIC_NAMES[NUM_METRICS] = {
+    "macro_precision", "macro_recall", "macro_f1", "g_mean", "MACC", "MAUC", "MMCC", "Cohens_Kappa", "thread_cpu_time_ms"
+};
+
+// Resample the training set of one fold, e.g. a call to Proposed::fit_resample
+typedef std::function<std::vector<std::vector<float>>(const std::vector<std::vector<float>> &training_set, const uint32_t n_classes)> ResampleFunction;
+
+typedef struct ExperimentSummary{
+    std::string algorithm_name;
+    std::string dataset_name;
+    uint32_t n_evaluations;        // n_runs * n_folds
+    std::vector<float> means;      // NUM_METRICS
+    std::vector<float> stds;       // NUM_METRICS, sample standard deviation
+    std::vector<float> pooled;     // NUM_POOLED_METRICS of the predictions of all evaluations pooled together
+    std::vector<float> pooled_lower, pooled_upper; // NUM_POOLED_METRICS, bootstrap percentile interval of pooled
+    uint64_t bootstrap_seed;                       // seed of the intervals, see MetricsAccumulator::ComputeBootstrapIntervals
+}ExperimentSummary;
+
+// Parse and normalize the first n_folds folds of dataset_name under datasets_dir
+std::vector<Dataset> LoadFolds(const std::string datasets_dir, const std::string dataset_name, const uint32_t n_folds);
+
+// Rows of the dataset the folds were drawn from, i.e. the training and testing sets of the first fold, and the row of
+// every training row of every fold in it (fold_idxes[fold_idx][data_idx]), matched by value with duplicates matched
+// to distinct rows. The folds share one normalization, so their rows are equal to those of the dataset. Returns false
+// when a training row is not found, e.g. for folds of different datasets.
+bool MapFoldRows(const std::vector<Dataset> &folds, std::vector<std::vector<float>> &dataset, 
+                    std::vector<std::vector<uint32_t>> &fold_idxes);
+
+// Resample the training set of fold, train on it and write NUM_METRICS values to metrics; the running time is measured
+// by EXPERIMENT_CLOCK, so resample must run on the calling thread.
+// The predictions are also merged into accumulator when it is given.
+void EvaluateFold(const Dataset &fold, const decision_tree_parameter dtc_params, const ResampleFunction &resample, float *metrics,
+                    MetricsAccumulator *accumulator = nullptr);
+
+// Like EvaluateFold for a training set of fold resampled beforehand; the running time only covers training and testing
+void EvaluateResampledSet(const Dataset &fold, const std::vector<std::vector<float>> &resampled_set, const decision_tree_parameter dtc_params, 
+                            float *metrics, MetricsAccumulator *accumulator = nullptr);
+
+// Mean and std of each metric over n_evaluations rows of NUM_METRICS values, and the pooled metrics of accumulator
+// with their bootstrap intervals. Each bootstrap resample has the size of one run, i.e. the accumulated predictions / n_runs,
+// and the resamples are drawn from bootstrap_seed.
+ExperimentSummary SummarizeMetrics(const std::string algorithm_name, const std::string dataset_name, 
+                                        const float *metrics, const uint32_t n_evaluations,
+                                            const MetricsAccumulator *accumulator = nullptr, const uint32_t n_runs = 1,
+                                                const uint64_t bootstrap_seed = BOOTSTRAP_SEED);
+
+// Load the folds of dataset_name once from datasets_dir, then resample, train and evaluate every
+// (run, fold) pair on n_threads workers and aggregate the metrics in process.
+// Real-world datasets have 5 folds; synthetic datasets only use their first fold.
+ExperimentSummary RunRepeatedCrossValidation(const std::string datasets_dir, const std::string dataset_name, 
+                                                const uint32_t n_folds, const uint32_t n_runs, 
+                                                    const decision_tree_parameter dtc_params,
+                                                        const ResampleFunction &resample, const uint32_t n_threads);
+
+// Write one CSV line per (algorithm, dataset): names, n_evaluations, mean and std of every metric, then the pooled metrics,
+// their bootstrap intervals and the seed of the intervals
+void WriteExperimentSummaries(const std::string output_path, const std::vector<ExperimentSummary> &summaries);
+
+#endif // EXPERIMENT_DRIVER_H
@@ -15,6 +15,7 @@ typedef struct Dataset{
 
 // The labels in the training and testing sets must start from 1 and be placed after the attributes
 // Return the normalized training and testing sets
+// Gzip (.gz) and zstd (.zst) compressed files are detected by magic number and decompressed on the fly
 Dataset ReadTrainingAndTestingSet(std::string training_path, std::string testing_path);
 
 #endif // FILE_OPERATIONS_H
\ No newline at end of file
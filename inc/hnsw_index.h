@@ -0,0 +1,64 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include <cmath>      // sqrt, log, floor
+#include <queue>      // std::priority_queue
+#include <random>     // std::mt19937, std::uniform_real_distribution
+#include <vector>     // std::vector
+#include <cstdint>    // uint32_t
+#include <utility>    // std::pair
+#include <algorithm>  // std::sort, std::max
+#include <functional> // std::greater
+#include "../inc/nearest_neighbors.h"
+
+#define HNSW_M    16 // Links per node on the upper layers, twice as many on the bottom layer
+#define HNSW_SEED 0  // Seed of the layer assignment, so that an index is reproducible
+
+// Hierarchical navigable small-world graph over the feature columns of a dataset whose last column stores
+// the label. Every row is linked to near rows on the bottom layer and to a geometrically thinning subset of
+// rows on the layers above, and a query descends greedily from the top layer before a best-first search of
+// ef candidates on the bottom layer. The neighbors found are approximate: a larger ef costs time and finds
+// more of the exact ones. Their distances are summed like EuclideanDistance, so they are identical to it.
+// The index is immutable once built and can be queried from several threads, each with its own scratch.
+class HNSWIndex{
+    public:
+        // Per-thread visited marks of a search, reused between queries
+        typedef struct Scratch{
+            std::vector<uint32_t> visited; // epoch of the last search that reached each row
+            uint32_t epoch;
+        }Scratch;
+
+        // ef is the candidate list size of the insertions; it is also the default search quality
+        HNSWIndex(const std::vector<std::vector<float>> &dataset, const uint32_t ef);
+        ~HNSWIndex() = default;
+
+        uint32_t GetNumData(void) const
+        {
+            return n_data_;
+        }
+
+        Scratch CreateScratch(void) const;
+        // About the k nearest rows of query (a row with the label column) by ascending (distance, index),
+        // skipping the row exclude_idx, from a best-first search of max(ef, k + 1) candidates
+        void FindNearest(const std::vector<float> &query, const uint32_t k, const uint32_t ef, const uint32_t exclude_idx,
+                            Scratch &scratch, std::vector<std::pair<float, uint32_t>> &neighbors) const;
+
+    private:
+        uint32_t n_data_;
+        uint32_t n_features_;
+        uint32_t entry_point_;
+        uint32_t max_level_;
+        std::vector<float> points_;                    // n_data_ x n_features_
+        std::vector<std::vector<std::vector<uint32_t>>> links_; // links_[row][level]
+
+        float GetSquareDistance(const float *query, const uint32_t data_idx) const;
+        // Closest rows to query among those reachable on level from the entry points, as (square distance, index) ascending
+        std::vector<std::pair<float, uint32_t>> SearchLayer(const float *query, const std::vector<std::pair<float, uint32_t>> &entry_points,
+                                                                const uint32_t ef, const uint32_t level, Scratch &scratch) const;
+        // Up to max_links candidates (ascending) that are closer to the row than to every link kept before them,
+        // so that links spread in all directions; the nearest pruned ones fill the remaining slots
+        std::vector<uint32_t> SelectLinks(const std::vector<std::pair<float, uint32_t>> &candidates, const uint32_t max_links) const;
+        void Insert(const uint32_t data_idx, const uint32_t level, const uint32_t ef, Scratch &scratch);
+};
+
+#endif // HNSW_INDEX_H
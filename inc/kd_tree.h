@@ -0,0 +1,66 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <cmath>     // sqrt
+#include <vector>    // std::vector
+#include <cstdint>   // uint32_t
+#include <utility>   // std::pair
+#include <numeric>   // std::iota
+#include <algorithm> // std::nth_element, std::sort_heap
+#include "../inc/nearest_neighbors.h"
+
+#define KD_TREE_LEAF_SIZE 16 // Rows scanned together once a node is reached
+
+// KD-tree over the feature columns of a subset of the rows of a dataset whose last column stores the label.
+// The indexed rows are copied contiguously in tree order, and every node keeps the bounding box of its rows,
+// so queries skip the nodes that cannot hold a better neighbor. The tree is immutable once built and can be
+// queried from several threads. Distances are summed like EuclideanDistance, so they are identical to it,
+// and neighbors are ordered by distance with ties by ascending index, like the brute search.
+class KDTree{
+    public:
+        // Index all rows of dataset
+        KDTree(const std::vector<std::vector<float>> &dataset);
+        // Index the rows data_idxes of dataset; returned neighbor indexes are rows of dataset
+        KDTree(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &data_idxes);
+        ~KDTree() = default;
+
+        uint32_t GetNumData(void) const
+        {
+            return idxes_.size();
+        }
+
+        // k nearest indexed rows of query (a row with the label column) by ascending (distance, index),
+        // skipping the row exclude_idx, e.g. the query itself
+        void FindNearest(const std::vector<float> &query, const uint32_t k, const uint32_t exclude_idx,
+                            std::vector<std::pair<float, uint32_t>> &neighbors) const;
+        // k farthest indexed rows of query by descending distance, ties by ascending index
+        void FindFarthest(const std::vector<float> &query, const uint32_t k, std::vector<std::pair<float, uint32_t>> &neighbors) const;
+
+    private:
+        typedef struct Node{
+            uint32_t begin;         // rows idxes_[begin..end) are below the node
+            uint32_t end;
+            uint32_t left;          // child nodes, 0 for a leaf
+            uint32_t right;
+            uint32_t split_feature;
+            float split_value;      // left rows have split_feature <= split_value, right rows >=
+        }Node;
+
+        uint32_t n_features_;
+        std::vector<uint32_t> idxes_; // row of dataset of every point in tree order
+        std::vector<float> points_;   // idxes_.size() x n_features_
+        std::vector<Node> nodes_;     // nodes_[0] is the root
+        std::vector<float> lowers_;   // nodes_.size() x n_features_ bounding boxes
+        std::vector<float> uppers_;
+
+        void Build(const std::vector<std::vector<float>> &dataset);
+        uint32_t BuildNode(const std::vector<std::vector<float>> &dataset, const uint32_t begin, const uint32_t end);
+        float GetBoxSquareDistance(const uint32_t node_idx, const float *query) const;
+        float GetBoxSquareFarthestDistance(const uint32_t node_idx, const float *query) const;
+        // heaps hold (distance, index) for nearest and (-distance, index) for farthest searches
+        void SearchNearest(const uint32_t node_idx, const float *query, const uint32_t k, const uint32_t exclude_idx,
+                            std::vector<std::pair<float, uint32_t>> &heap) const;
+        void SearchFarthest(const uint32_t node_idx, const float *query, const uint32_t k, std::vector<std::pair<float, uint32_t>> &heap) const;
+};
+
+#endif // KD_TREE_H
@@ -0,0 +1,83 @@
+#ifndef METRICS_ACCUMULATOR_H
+#define METRICS_ACCUMULATOR_H
+
+#include <map>     // std::map
+#include <random>  // std::mt19937_64, std::binomial_distribution
+#include <cstdio>  // printf
+#include <cmath>   // pow, sqrt
+#include <vector>  // std::vector
+#include <limits>  // std::numeric_limits
+#include <numeric> // std::accumulate, std::iota
+#include <cstdint> // uint32_t, uint64_t
+#include <algorithm> // std::max_element, std::sort
+#include "../inc/thread_pool.h" // ParallelFor
+
+typedef struct Metrics{
+    float macro_precision;
+    float macro_recall;
+    float macro_f1;
+    float g_mean;
+    float MACC;
+    float MAUC;
+    float MMCC;
+    float Cohens_Kappa;
+}Metrics;
+
+typedef struct MetricsInterval{
+    Metrics lower;
+    Metrics upper;
+}MetricsInterval;
+
+// Sufficient statistics of a stream of predictions: the confusion matrix and, for the exact ROC curves,
+// the class counts of every distinct probability row. Accumulators of disjoint batches, threads or folds
+// can be merged, and the metrics of the merged accumulator are the pooled metrics.
+class MetricsAccumulator{
+    public:
+        MetricsAccumulator(const uint32_t n_classes);
+
+        // predict_prob has n_classes + 1 entries (index 0 unused); the predicted label is its argmax
+        void Add(const std::vector<float> &predict_prob, const uint32_t actual_label);
+        // Predictions sharing predict_prob, e.g. the testing data reaching one tree leaf; class_counts has n_classes + 1 entries
+        void AddGroup(const std::vector<float> &predict_prob, const std::vector<uint32_t> &class_counts);
+        void Merge(const MetricsAccumulator &other);
+        void Reset(void);
+
+        // macro_flag averages MAUC over classes for binary problems too; ROC curves are computed on n_threads
+        Metrics ComputeMetrics(const bool macro_flag = false, const uint32_t n_threads = 1) const;
+        // Bootstrap percentile intervals of every metric. Each resample draws n_draws predictions (0 = GetNumData())
+        // with replacement from the accumulated ones; resamples run on n_threads and resample i is seeded with seed + i.
+        MetricsInterval ComputeBootstrapIntervals(const uint32_t n_resamples, const float confidence_level, const uint64_t n_draws,
+                                                    const uint64_t seed, const bool macro_flag = false, const uint32_t n_threads = 1) const;
+
+        uint32_t GetNumClasses(void) const {return n_classes;};
+        uint64_t GetNumData(void) const {return n_data;};
+        // Count of testing data predicted as predicted_label whose ground truth is actual_label
+        uint64_t GetConfusion(const uint32_t predicted_label, const uint32_t actual_label) const {
+            return confusion_matrix[predicted_label * (n_classes + 1) + actual_label];
+        };
+
+    private:
+        uint32_t n_classes;
+        uint64_t n_data;
+        std::vector<uint64_t> confusion_matrix; // (n_classes + 1) x (n_classes + 1), [predicted][actual]
+        std::map<std::vector<float>, std::vector<uint64_t>> score_class_counts; // probability row -> class counts
+
+        // The distinct probability rows in a fixed order, with their predicted labels and, per class,
+        // the rows sorted by descending probability. It only depends on the rows, not on their counts,
+        // so bootstrap resamples reuse it.
+        typedef struct GroupTable{
+            uint32_t n_groups;
+            std::vector<const std::vector<float> *> probs;
+            std::vector<uint32_t> predicted_labels;
+            std::vector<std::vector<uint32_t>> sorted_group_idxes; // n_classes + 1 (index 0 unused)
+        }GroupTable;
+
+        GroupTable BuildGroupTable(const uint32_t n_threads) const;
+        // group_class_counts is a flat n_groups x (n_classes + 1) table in the order of table
+        float CalculateOVRAUC(const GroupTable &table, const std::vector<uint64_t> &group_class_counts, const uint32_t pos_label) const;
+        float CalculateMAUC(const GroupTable &table, const std::vector<uint64_t> &group_class_counts, 
+                                const bool macro_flag, const uint32_t n_threads) const;
+        void ComputeConfusionMetrics(const std::vector<uint64_t> &confusion_matrix, Metrics &metrics) const;
+};
+
+#endif // METRICS_ACCUMULATOR_H
@@ -0,0 +1,139 @@
+#ifndef NEAREST_NEIGHBORS_H
+#define NEAREST_NEIGHBORS_H
+
+#include <cmath>     // pow, sqrt, ceil
+#include <cstdio>    // printf
+#include <cstdlib>   // exit
+#include <limits>    // std::numeric_limits
+#include <memory>    // std::unique_ptr
+#include <vector>    // std::vector
+#include <cstdint>   // uint32_t
+#include <utility>   // std::pair
+#include <algorithm> // std::push_heap, std::pop_heap, std::sort_heap
+#include "../inc/thread_pool.h"
+#include "../inc/distance_matrix.h"
+
+#define KNN_QUERY_BLOCK_SIZE     64   // Queries sharing one pass over the data, also the unit of work of a thread
+#define KNN_DATA_BLOCK_SIZE      256  // Data rows kept hot in cache while every query of a block scans them
+#define KNN_BOUND_MARGIN         1e-5 // Relative slack on the squared distance of the worst kept neighbor
+#define KNN_KD_TREE_MIN_DATA       16   // NEIGHBOR_SEARCH_AUTO builds a KD-tree from MIN_DATA * FEATURE_GROWTH^n_features rows
+#define KNN_KD_TREE_FEATURE_GROWTH 2.25 // for nearest and from MIN_FARTHEST rows for farthest queries; below, pruning does
+#define KNN_KD_TREE_MIN_FARTHEST   128  // not pay off against the brute search
+#define KNN_HNSW_EF              64   // Default candidate list size of NEIGHBOR_SEARCH_HNSW, its quality knob
+#define KNN_GRAPH_MIN_K          16   // NeighborGraph keeps max(MIN_K, SQRT_FACTOR * sqrt(N)) neighbors of each of N rows,
+#define KNN_GRAPH_SQRT_FACTOR    2    // twice the sqrt(class count) neighbors of Proposed before held-out rows are filtered
+
+// How neighbor queries are answered. The exact searches return the same neighbors in the same order.
+typedef enum NeighborSearch{
+    NEIGHBOR_SEARCH_AUTO,    // KD-tree for sets large for their dimension and without dist_cache, brute force otherwise
+    NEIGHBOR_SEARCH_BRUTE,   // scan every row, reading dist_cache when it is given
+    NEIGHBOR_SEARCH_KD_TREE, // KD-tree over the feature columns, dist_cache is not read
+    NEIGHBOR_SEARCH_HNSW,    // approximate nearest neighbors from a small-world graph (hnsw_index.h), dist_cache is not
+                             // read; farthest queries are answered like NEIGHBOR_SEARCH_AUTO
+}NeighborSearch;
+
+// Neighbor lists of all queries stored back to back: the neighbors of query q are
+// idxes[offsets[q]..offsets[q + 1]) with their distances in dists, sorted from the best neighbor
+// (ascending distance for nearest, descending for farthest queries, ties by ascending index).
+typedef struct NeighborLists{
+    std::vector<uint32_t> offsets; // n_queries + 1
+    std::vector<uint32_t> idxes;
+    std::vector<float> dists;
+
+    uint32_t GetNumNeighbors(const uint32_t query_idx) const
+    {
+        return offsets[query_idx + 1] - offsets[query_idx];
+    }
+}NeighborLists;
+
+// Keep candidate if it is among the k best (distance, idx) pairs of the max-heap
+inline void PushNeighbor(std::vector<std::pair<float, uint32_t>> &heap, const uint32_t k, const std::pair<float, uint32_t> &candidate)
+{
+    if(heap.size() < k){
+        heap.push_back(candidate);
+        std::push_heap(heap.begin(), heap.end());
+    }
+    else if(k > 0 && candidate < heap.front()){
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end());
+    }
+}
+
+// Squared distances beyond the returned bound cannot enter the heap. The margin keeps rows tied with
+// the worst kept neighbor, which are then ordered by index.
+inline float GetSquareDistanceBound(const std::vector<std::pair<float, uint32_t>> &heap, const uint32_t k)
+{
+    if(heap.size() < k){
+        return std::numeric_limits<float>::max();
+    }
+    else if(k == 0){
+        return -1.f;
+    }
+    return heap.front().first * heap.front().first * (1.f + KNN_BOUND_MARGIN);
+}
+
+// ks[q] nearest neighbors of every row q of dataset among the other rows, at most dataset.size() - 1.
+// The brute search processes queries in blocks against blocks of data through bounded per-query heaps,
+// so only O(N * k) memory is used; without dist_cache, approximate distances of each tile (distance_kernel.h)
+// skip the pairs that cannot enter a heap. A single thread computes each pair once for both rows; several threads
+// split the queries and compute every pair from both sides. Distances come from dist_cache when it is given
+// (row i of dataset is row cache_idxes[i] of the cache, or row i when cache_idxes is nullptr) and equal
+// EuclideanDistance otherwise. The KD-tree search (kd_tree.h) queries every row against a tree of all rows,
+// and the HNSW search against a graph built and searched with hnsw_ef candidates.
+NeighborLists FindKNearestNeighbors(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &ks,
+                                        const uint32_t n_threads = 1, const DistanceMatrix *dist_cache = nullptr,
+                                        const NeighborSearch search = NEIGHBOR_SEARCH_AUTO,
+                                        const std::vector<uint32_t> *cache_idxes = nullptr, const uint32_t hnsw_ef = KNN_HNSW_EF);
+
+// ks[q] farthest rows among the rows data_idxes of dataset from every row query_idxes[q], at most data_idxes.size(),
+// sorted by descending distance (ties by ascending index). Neighbor indexes are rows of dataset, and a query
+// that is also a data row is not skipped. Distances come from dist_cache in the brute search, indexed through
+// cache_idxes like FindKNearestNeighbors.
+NeighborLists FindKFarthestNeighbors(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &query_idxes,
+                                        const std::vector<uint32_t> &data_idxes, const std::vector<uint32_t> &ks,
+                                        const uint32_t n_threads = 1, const DistanceMatrix *dist_cache = nullptr,
+                                        const NeighborSearch search = NEIGHBOR_SEARCH_AUTO,
+                                        const std::vector<uint32_t> *cache_idxes = nullptr);
+
+// Reverse graph of the first n_kept[q] neighbors of every query q: list r holds the queries that kept row r,
+// by ascending query, with the same distances (e.g. the reverse nearest neighbors of every row). It is built
+// in two passes, counting the edges of every row and then filling them, into n_data lists.
+NeighborLists ReverseNeighbors(const NeighborLists &neighbors, const std::vector<uint32_t> &n_kept, const uint32_t n_data);
+
+// Exact nearest neighbors of every row of a dataset, kept to answer the nearest queries of its subsets, e.g. the training
+// sets of the folds of a cross-validation, without searching them again. A row's neighbors within a subset are its
+// neighbors in the graph that belong to the subset; a row with too few of them left scans the subset, computing its
+// distances on demand. Only the O(N * k) lists are kept besides the rows, which must outlive the graph.
+class NeighborGraph{
+    public:
+        // k nearest neighbors of every row of dataset by the exact search of FindKNearestNeighbors; see GetNeighborGraphK
+        NeighborGraph(const std::vector<std::vector<float>> &dataset, const uint32_t k, const uint32_t n_threads = 1);
+        ~NeighborGraph() = default;
+
+        uint32_t GetNumData(void) const
+        {
+            return dataset_.size();
+        }
+
+        // Same neighbors as FindKNearestNeighbors(subset, ks) for the subset whose row q is row row_idxes[q] of the graph,
+        // as long as the rows of row_idxes are distinct. Neighbor indexes are rows of the subset.
+        NeighborLists FindKNearestNeighbors(const std::vector<uint32_t> &row_idxes, const std::vector<uint32_t> &ks,
+                                                const uint32_t n_threads = 1) const;
+
+    private:
+        const std::vector<std::vector<float>> &dataset_;
+        NeighborLists neighbors_; // by ascending (distance, row), like the nearest queries
+};
+
+// Neighbors a NeighborGraph of n_data rows keeps for every row
+inline uint32_t GetNeighborGraphK(const uint32_t n_data)
+{
+    return std::max((uint32_t)KNN_GRAPH_MIN_K, (uint32_t)ceil(KNN_GRAPH_SQRT_FACTOR * sqrt((double)n_data)));
+}
+
+// Fraction of the exact neighbors that approx found, over all queries. A neighbor tied with the farthest
+// exact one of its query counts as found, so that ties broken differently are not misses.
+float ComputeRecall(const NeighborLists &approx, const NeighborLists &exact);
+
+#endif // NEAREST_NEIGHBORS_H
@@ -0,0 +1,120 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <vector>  // std::vector
+#include <cstdint> // uint32_t
+#include <utility> // std::move
+#include <cstdio>  // printf
+#include <cstdlib> // exit
+#include "../inc/distance_matrix.h"
+#include "../inc/nearest_neighbors.h" // NeighborSearch, NeighborGraph, FindKNearestNeighbors
+
+// Common interface of all resampling methods, so that one runner can schedule any of them
+class Resampler{
+    public:
+        Resampler()
+        {
+            dist_cache_      = nullptr;
+            cache_idxes_     = nullptr;
+            neighbor_graph_  = nullptr;
+            neighbor_search_ = NEIGHBOR_SEARCH_AUTO;
+            hnsw_ef_         = KNN_HNSW_EF;
+            n_threads_       = 1;
+        };
+        virtual ~Resampler() = default;
+
+        // tra_set is only read, so it can be fold data shared by several resamplers
+        virtual std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) = 0;
+
+        // Whether fit_resample needs the pairwise distances of tra_set
+        virtual bool uses_distances(void) const
+        {
+            return false;
+        }
+
+        // Precomputed distances between the rows of the next tra_set; nullptr computes them privately. Row i of tra_set
+        // is row cache_idxes[i] of dist_cache, or row i when cache_idxes is nullptr, so one cache can serve several
+        // subsets of a dataset. neighbor_graph, built over the same rows, then answers the nearest queries of
+        // NEIGHBOR_SEARCH_AUTO; it may also be given without dist_cache, with cache_idxes indexing its rows.
+        void set_distance_cache(const DistanceMatrix *dist_cache, const std::vector<uint32_t> *cache_idxes = nullptr,
+                                    const NeighborGraph *neighbor_graph = nullptr)
+        {
+            dist_cache_     = dist_cache;
+            cache_idxes_    = cache_idxes;
+            neighbor_graph_ = neighbor_graph;
+        }
+
+        // How neighbor queries of the next fit_resample are answered. The exact searches select the same rows;
+        // NEIGHBOR_SEARCH_HNSW trades some of them for time through hnsw_ef.
+        void set_neighbor_search(const NeighborSearch neighbor_search, const uint32_t hnsw_ef = KNN_HNSW_EF)
+        {
+            neighbor_search_ = neighbor_search;
+            hnsw_ef_         = hnsw_ef;
+        }
+
+        // Threads one fit_resample may use; schedulers running several resamplers at once keep the default 1
+        void set_num_threads(const uint32_t n_threads)
+        {
+            n_threads_ = n_threads;
+        }
+
+    protected:
+        const DistanceMatrix *dist_cache_;
+        const std::vector<uint32_t> *cache_idxes_;
+        const NeighborGraph *neighbor_graph_;
+        NeighborSearch neighbor_search_;
+        uint32_t hnsw_ef_;
+        uint32_t n_threads_;
+
+        // Exit if the distance cache or neighbor graph cannot hold the rows of a tra_set of n_data rows
+        void check_distance_cache(const uint32_t n_data) const
+        {
+            if(dist_cache_ != nullptr && ((cache_idxes_ == nullptr) ? dist_cache_->GetNumData() != n_data : cache_idxes_->size() != n_data)){
+                printf("./%s:%d: error: distance cache does not match the training set\n", __FILE__, __LINE__);
+                exit(1);
+            }
+            if(dist_cache_ == nullptr && neighbor_graph_ != nullptr && (cache_idxes_ == nullptr || cache_idxes_->size() != n_data)){
+                printf("./%s:%d: error: neighbor graph does not match the training set\n", __FILE__, __LINE__);
+                exit(1);
+            }
+        }
+
+        // Row of the distance cache that holds row data_idx of the tra_set
+        uint32_t get_cache_idx(const uint32_t data_idx) const
+        {
+            return (cache_idxes_ != nullptr) ? (*cache_idxes_)[data_idx] : data_idx;
+        }
+
+        // FindKNearestNeighbors over rows of the tra_set, where row i of dataset is row cache_idxes[i] of the distance cache
+        // and neighbor graph. The neighbor graph answers instead when it is given, since it returns the same neighbors.
+        // is_exact searches exactly even under NEIGHBOR_SEARCH_HNSW, for resamplers that repair the lists by exact searches.
+        NeighborLists find_k_nearest_neighbors(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &ks,
+                                                    const std::vector<uint32_t> *cache_idxes, const uint32_t n_threads,
+                                                    const bool is_exact = false) const
+        {
+            const NeighborSearch search = (is_exact && neighbor_search_ == NEIGHBOR_SEARCH_HNSW) ? NEIGHBOR_SEARCH_AUTO
+                                                                                                 : neighbor_search_;
+            if(neighbor_graph_ != nullptr && cache_idxes != nullptr && search == NEIGHBOR_SEARCH_AUTO){
+                return neighbor_graph_->FindKNearestNeighbors(*cache_idxes, ks, n_threads);
+            }
+            return FindKNearestNeighbors(dataset, ks, n_threads, dist_cache_, search, cache_idxes, hnsw_ef_);
+        }
+};
+
+// Keep the rows whose is_kept entry is true, in their order. One stable pass moves every kept row once, whereas
+// erasing the dropped rows one by one shifts the tail of rows for each of them.
+inline void CompactRows(std::vector<std::vector<float>> &rows, const std::vector<bool> &is_kept)
+{
+    uint32_t n_kept = 0;
+    for(uint32_t data_idx = 0; data_idx < rows.size(); data_idx++){
+        if(is_kept[data_idx]){
+            if(n_kept != data_idx){
+                rows[n_kept] = std::move(rows[data_idx]);
+            }
+            n_kept++;
+        }
+    }
+    rows.resize(n_kept);
+}
+
+#endif // RESAMPLER_H
@@ -0,0 +1,55 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>  // std::atomic
+#include <thread>  // std::thread
+#include <vector>  // std::vector
+#include <cstdint> // uint32_t
+
+// Number of worker threads, NUM_THREADS overrides the hardware concurrency
+inline uint32_t GetNumThreads(void)
+{
+#ifdef NUM_THREADS
+    return NUM_THREADS;
+#else
+    uint32_t n_threads = std::thread::hardware_concurrency();
+    return (n_threads > 0) ? n_threads : 1;
+#endif
+}
+
+// Run task(task_idx, thread_idx) for every task_idx in [0, n_tasks).
+// Workers pull the next task from a shared counter, so uneven tasks are balanced dynamically.
+template<typename Task>
+void ParallelFor(const uint32_t n_tasks, uint32_t n_threads, Task task)
+{
+    if(n_threads > n_tasks){
+        n_threads = n_tasks;
+    }
+
+    if(n_threads <= 1){
+        for(uint32_t task_idx = 0; task_idx < n_tasks; task_idx++){
+            task(task_idx, 0);
+        }
+        return;
+    }
+
+    std::atomic<uint32_t> next_task_idx(0);
+    auto worker = [&](const uint32_t thread_idx){
+        uint32_t task_idx;
+        while((task_idx = next_task_idx.fetch_add(1)) < n_tasks){
+            task(task_idx, thread_idx);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for(uint32_t thread_idx = 1; thread_idx < n_threads; thread_idx++){
+        threads.emplace_back(worker, thread_idx);
+    }
+    worker(0); // the calling thread works too
+    for(uint32_t thread_idx = 0; thread_idx < threads.size(); thread_idx++){
+        threads[thread_idx].join();
+    }
+}
+
+#endif // THREAD_POOL_H
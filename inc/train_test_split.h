@@ -1,12 +1,36 @@
 #ifndef TRAIN_TEST_SPLIT_H
 #define TRAIN_TEST_SPLIT_H
 
+#include <cmath>     // ceil
 #include <random>    // std::default_random_engine
 #include <chrono>    // std::chrono  
 #include <algorithm> // shuffle
 #include <iostream>
-#include "../../inc/file_operations.h"
+#include "../inc/file_operations.h"
 
+// Stratified k-fold partition expressed as row indexes of one shared dataset.
+// All k folds together take O(N) memory instead of k copies of the dataset.
+typedef struct KFoldIdxes{
+    uint32_t k;
+    std::vector<uint32_t> shuffled_idxes;             // every row, grouped by class in shuffled order
+    std::vector<uint32_t> held_out_fold;              // fold in which each row is held out (k: never held out)
+    std::vector<std::vector<uint32_t>> testing_idxes; // rows tested in each fold
+}KFoldIdxes;
+
+// Index-based splits: only row indexes are produced, the dataset itself is never copied
+void TrainTestSplitIdxes(const std::vector<std::vector<float>> &dataset, const float split_ratio, std::vector<uint32_t> &training_idxes, std::vector<uint32_t> &testing_idxes, const uint32_t n_classes);
+void KFoldSplitIdxes(const std::vector<std::vector<float>> &dataset, const uint32_t n_classes, const uint32_t k, KFoldIdxes &folds);
+std::vector<uint32_t> GetTrainingIdxes(const KFoldIdxes &folds, const uint32_t fold_idx);
+// Stratified samples of about sample_size rows: every class contributes ceil(class count * sample_size / N) rows, at least one.
+// The subsample draws them without replacement and keeps every row when N <= sample_size; the bootstrap draws with replacement.
+// Both are in ascending row order.
+void StratifiedSubsampleIdxes(const std::vector<std::vector<float>> &dataset, const uint32_t sample_size, std::vector<uint32_t> &idxes, const uint32_t n_classes);
+void StratifiedBootstrapIdxes(const std::vector<std::vector<float>> &dataset, const uint32_t sample_size, std::vector<uint32_t> &idxes, const uint32_t n_classes);
+
+// Materialize the rows referred to by idxes, in the order of idxes
+void GatherData(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &idxes, std::vector<std::vector<float>> &subset);
+
+// Copying adapters for legacy callers
 void TrainTestSplit(const std::vector<std::vector<float>>&dataset, const float split_ratio, std::vector<std::vector<float>> &training_set, std::vector<std::vector<float>> &testing_set, const uint32_t n_classes);
 void KFoldSplit(const std::vector<std::vector<float>>& dataset, const uint32_t n_classes, const uint32_t k, std::vector<std::vector<std::vector<float>>> &training_set, std::vector<std::vector<std::vector<float>>> &testing_set);
 
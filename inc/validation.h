@@ -6,12 +6,22 @@
 #include <vector> // std::vector
 #include <limits> // std::numeric_limits
 #include "../inc/decision_tree_classifier.h" // CreateDecisionTree, PredictByDecisionTree
+#include "../inc/thread_pool.h" // ParallelFor
+#include "../inc/metrics_accumulator.h" // MetricsAccumulator
+
+#define VALIDATION_CHUNK_SIZE 1024 // Testing data scored per task; smaller testing sets stay on the calling thread
 
 #include <iostream>
 
 class Validation{
     public:
-        Validation(const std::vector<std::vector<float>> &training_set, const std::vector<std::vector<float>> &testing_set, const uint32_t n_classes, const decision_tree_parameter dtc_params, const bool macro_flag);
+        // Train a decision tree on training_set and score it on testing_set
+        Validation(const std::vector<std::vector<float>> &training_set, const std::vector<std::vector<float>> &testing_set, const uint32_t n_classes, const decision_tree_parameter dtc_params, const bool macro_flag, const uint32_t n_threads = 1);
+        // Score an already trained decision tree, e.g. one model against several testing sets
+        Validation(const DecisionTreeClassifier &dtc, const std::vector<std::vector<float>> &testing_set, const uint32_t n_classes, const bool macro_flag, const uint32_t n_threads = 1);
+        // Score precomputed predictions: predict_prob is a flat row-major n x (n_classes + 1) matrix (column 0 unused)
+        // and ground_truth holds the n labels, e.g. the output of any classifier on a cached testing set
+        Validation(const std::vector<float> &predict_prob, const std::vector<uint32_t> &ground_truth, const uint32_t n_classes, const bool macro_flag, const uint32_t n_threads = 1);
         ~Validation();
 
         float macro_precision;
@@ -23,15 +33,16 @@ class Validation{
         float MMCC;
         float Cohens_Kappa;
         std::vector<std::vector<uint32_t>> confusion_matrix; 
+        MetricsAccumulator accumulator; // Can be merged with the accumulators of other folds for pooled metrics
     
     private:
         const uint32_t n_classes;
+        const uint32_t n_threads;
 
-        std::vector<uint32_t> CalculateClassCounts(const std::vector<std::vector<float>> &training_set);
-        void ConstructConfusionMatrix(const std::vector<std::vector<float>> &testing_set, DecisionTreeClassifier &dtc, const bool macro_flag = false);
-        float CalculateOVRAUC (const std::vector<uint32_t> &ground_truth, const std::vector<std::vector<float>> &predict_prob, 
-                                    const uint32_t pos_label);
-        void ComputeMetrics(void);
+        void Initialize(void);
+        void ConstructConfusionMatrix(const std::vector<std::vector<float>> &testing_set, const DecisionTreeClassifier &dtc);
+        void ConstructConfusionMatrix(const std::vector<float> &predict_prob, const std::vector<uint32_t> &ground_truth);
+        void ComputeMetrics(const bool macro_flag = false);
 
 };
 
@@ -0,0 +1,29 @@
+#ifndef WEIGHTED_SAMPLER_H
+#define WEIGHTED_SAMPLER_H
+
+#include <random>  // std::mt19937, std::uniform_real_distribution
+#include <vector>  // std::vector
+#include <cstdint> // uint32_t
+
+// Roulette-wheel selection over non-negative weights backed by a Fenwick tree of prefix sums, so that a draw
+// and a weight update take O(log N) instead of a scan. A draw picks index i with probability weight[i] / total,
+// as the first index whose prefix sum reaches a uniform value in [0, total), like the linear scan it replaces.
+class WeightedSampler{
+    public:
+        WeightedSampler(const std::vector<float> &weights);
+        ~WeightedSampler() = default;
+
+        // Sum of the weights; 0 once every positive weight has been removed
+        double GetTotal(void) const;
+        uint32_t Sample(std::mt19937 &gen) const;
+        // Set the weight of idx to 0, i.e. sample without replacement
+        void Remove(const uint32_t idx);
+
+    private:
+        uint32_t n_positive_;            // weights above 0, so that rounding left in the tree is not sampled
+        uint32_t top_step_;              // largest power of two not above weights_.size()
+        std::vector<float> weights_;
+        std::vector<double> tree_;       // tree_[i] sums weights_(i - (i & -i), i], 1-based
+};
+
+#endif // WEIGHTED_SAMPLER_H
@@ -19,20 +19,92 @@
 #include <queue>
 #include <vector>
 #include <utility> // std::pair
+#include <numeric> // std::iota
+#include <iterator> // std::back_inserter
 #include <iostream>
 #include <algorithm>
 #include "../../inc/validation.h"
 #include "../../inc/file_operations.h"
-#include "../inc/train_test_split.h"
+#include "../../inc/train_test_split.h"
+#include "../../inc/resampler.h"
+#include "../../inc/nearest_neighbors.h"
+#include "../../inc/weighted_sampler.h"
 
-class Proposed{
+#define PROPOSED_MS_BFS_WIDTH 64 // Sources advanced together by INF_SCORE_MS_BFS, one bit of a machine word each
+#define PROPOSED_PRE_VALIDATION_MAX_ROWS 2000 // Training rows of the sampled pre-validation strategies
+#define PROPOSED_PRE_VALIDATION_TREES    5    // Trees of PRE_VALIDATION_OUT_OF_BAG, which share MAX_ROWS training rows
+#define PROPOSED_INCREMENTAL_K_HEADROOM  2    // Class growth the incremental neighbor lists are kept for before a row is searched again
+
+// How compute_inf_scores walks the level-hop RNN neighborhoods. Both find the same neighborhoods;
+// INF_SCORE_MS_BFS adds the distances beyond the first hop by ascending row instead of in search order,
+// so scores may differ in the last bits when the level is above 1.
+typedef enum InfScoreEngine{
+    INF_SCORE_PER_SOURCE, // one breadth-first search per source
+    INF_SCORE_MS_BFS,     // one multi-source breadth-first search per PROPOSED_MS_BFS_WIDTH sources
+}InfScoreEngine;
+
+// How the confusion matrix and MAUC that weight the influence scores are estimated on the training set
+typedef enum PreValidation{
+    PRE_VALIDATION_HOLDOUT,    // one tree trained on a stratified 70% of the rows and tested on the other 30%
+    PRE_VALIDATION_SUBSAMPLE,  // PRE_VALIDATION_HOLDOUT within a stratified subsample of at most about max_rows rows
+    PRE_VALIDATION_OUT_OF_BAG, // PROPOSED_PRE_VALIDATION_TREES trees on stratified bootstraps of max_rows / n_trees rows,
+                               // every row tested by the trees whose bootstrap missed it
+}PreValidation;
+
+class Proposed : public Resampler{
     public:
         Proposed(const decision_tree_parameter &dtc_params) :dtc_params_(dtc_params)
         {
             n_classes_ = 0;
+            level_     = PROPOSED_LEVEL;
+            scored_level_ = 0;
+            pre_validation_          = PRE_VALIDATION_HOLDOUT;
+            pre_validation_max_rows_ = PROPOSED_PRE_VALIDATION_MAX_ROWS;
+#ifdef PROPOSED_MS_BFS
+            inf_score_engine_ = INF_SCORE_MS_BFS;
+#else
+            inf_score_engine_ = INF_SCORE_PER_SOURCE;
+#endif
         };
         ~Proposed() = default;
-        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes);
+        std::vector<std::vector<float>> fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) override;
+        bool uses_distances(void) const override {return true;}
+
+        void set_inf_score_engine(const InfScoreEngine inf_score_engine)
+        {
+            inf_score_engine_ = inf_score_engine;
+        }
+
+        void set_pre_validation(const PreValidation pre_validation, const uint32_t max_rows = PROPOSED_PRE_VALIDATION_MAX_ROWS)
+        {
+            pre_validation_          = pre_validation;
+            pre_validation_max_rows_ = max_rows;
+        }
+
+        // Estimate of the decision tree on tra_set by the pre-validation strategy, whose confusion matrix and MAUC
+        // weight the influence scores
+        std::unique_ptr<Validation> pre_validate(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) const;
+
+        // Hops of the RNN neighborhoods that score a row, PROPOSED_LEVEL by default
+        void set_level(const uint32_t level)
+        {
+            level_ = level;
+        }
+
+        // Resampled sets of every level from 1 to max_level, [level - 1], from one search of the RNN graph that is
+        // scored after every level; the sets are drawn like fit_resample after set_level(level). The search is the
+        // per-source one, whose scores of a level do not depend on the deeper levels.
+        std::vector<std::vector<std::vector<float>>> fit_resample_levels(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes, 
+                                                                            const uint32_t max_level);
+
+        // Incremental mode for a training set that only grows: new_rows are appended to the rows of the earlier calls and
+        // the resampled set of all of them is returned, drawn like fit_resample on the whole set. The nearest neighbors and
+        // RNN graph are kept between calls, so a call only searches the new rows, merges them into the neighbor lists of
+        // the old ones and searches again the BFS of the rows whose level-hop RNN neighborhood changed. The pre-validation
+        // runs on every call, see set_pre_validation. The search is the per-source one and no distance cache is read.
+        std::vector<std::vector<float>> fit_resample_incremental(const std::vector<std::vector<float>> &new_rows, const uint32_t n_classes);
+        // Forget the rows of fit_resample_incremental, which fit_resample also does
+        void reset_incremental(void);
     
     private:
         uint32_t n_classes_;
@@ -42,15 +114,40 @@ class Proposed{
 
         const decision_tree_parameter &dtc_params_;
         std::unique_ptr<std::vector<std::vector<float>>> res_set_; // resampled set
-        std::unique_ptr<std::vector<std::vector<std::pair<uint32_t, float>>>> dist_mat_;
 
-        std::vector<std::vector<uint32_t>> RNN;
-        std::vector<float> inf_scores_;
+        NeighborLists RNN_; // reverse nearest neighbors of every row with their distances, see ReverseNeighbors
+        std::vector<std::vector<float>> level_inf_scores_; // [level][data_idx], the levels not scored are empty
+        InfScoreEngine inf_score_engine_;
+        uint32_t level_;
+        PreValidation pre_validation_;
+        uint32_t pre_validation_max_rows_;
+
+        // State of fit_resample_incremental over the rows of res_set_, empty outside of it
+        std::vector<std::vector<std::pair<float, uint32_t>>> knn_lists_; // nearest (distance, row) of the searched rows
+        std::vector<uint32_t> knn_caps_;                                 // rows a list is kept to, see update_knn_lists
+        std::vector<uint32_t> n_kept_;                                   // adaptive k of every searched row, see find_RNN
+        std::vector<uint32_t> rnn_label_cnts_;                           // [data_idx * (n_classes_ + 1) + label] rows of label
+        std::vector<float> rnn_label_dist_sums_;                         // in the scored_level_-hop neighborhood and their distances
+        uint32_t scored_level_;
 
+        float get_distance(const uint32_t src_idx, const uint32_t dst_idx) const;
+        bool is_harmful(const uint32_t src_label, const uint32_t rnn_label, const std::vector<std::vector<uint32_t>> &confusion_matrix) const;
+        float get_inf_score(const uint32_t src_label, const uint32_t n_pos_RNNs, const uint32_t n_neg_RNNs,
+                                const float pos_dist_sum, const float neg_dist_sum) const;
         void compute_kmax(void);
         void find_RNN(void);
-        void compute_inf_scores(const std::vector<std::vector<uint32_t>> &confusion_matrix);
-        void rw_select_by_inf_scores(std::vector<bool> &selection_result, const uint32_t n_rounds);
+        void compute_inf_scores(const std::vector<std::vector<uint32_t>> &confusion_matrix, const uint32_t n_levels);
+        void compute_inf_scores_ms_bfs(const std::vector<std::vector<uint32_t>> &confusion_matrix, const uint32_t n_levels);
+        template<typename NeighborIdx>
+        uint32_t count_kept_neighbors(const uint32_t src_idx, const uint32_t n_neighbors, const NeighborIdx &get_neighbor_idx) const;
+        std::vector<uint32_t> update_knn_lists(void);
+        void compute_rnn_label_sums(const std::vector<uint32_t> &src_idxes, const uint32_t n_levels);
+        void compute_inf_scores_by_label(const std::vector<std::vector<uint32_t>> &confusion_matrix, const uint32_t n_levels);
+        std::vector<std::vector<float>> select_resampled_set(const std::vector<float> &inf_scores, const float MAUC);
+        void rw_select_by_inf_scores(const std::vector<float> &inf_scores, std::vector<bool> &selection_result, const uint32_t n_rounds);
+        // Resampled sets of the levels from 1 (from max_level without all_levels) to max_level
+        std::vector<std::vector<std::vector<float>>> resample_levels(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes,
+                                                                        const uint32_t max_level, const bool all_levels);
 };
 
 #endif
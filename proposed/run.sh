@@ -68,6 +68,11 @@ declare -a bin_real_world_datasets=(
 # 1 - Print results to the console
 DEBUG=0
 
+# Execution mode:
+# 0 - Launch ./main once per run and fold, and accumulate the metrics in bash
+# 1 - Run every run and fold inside ./driver, which writes the mean and std of each metric to a CSV file
+IN_PROCESS=0
+
 # Number of runs for each dataset
 NUM_RUNS=20
 NUM_METRICS=9
@@ -89,6 +94,23 @@ CMAKE_OPTIONS="
 cmake $CMAKE_OPTIONS ..
 make
 
+# ==================== Run all datasets in process ====================
+if [ "$IN_PROCESS" -eq 1 ]; then
+    if [ ! -d "../experiments" ]; then
+        mkdir -p ../experiments
+    fi
+    if [ ${#synthetic_datasets[@]} -gt 0 ]; then
+        ./driver ../experiments/dtc_exp_syn.csv 1 "$NUM_RUNS" "${synthetic_datasets[@]}" # Synthetic datasets only have one fold.
+    fi
+    if [ ${#mul_real_world_datasets[@]} -gt 0 ]; then
+        ./driver ../experiments/dtc_exp_mul.csv 5 "$NUM_RUNS" "${mul_real_world_datasets[@]}"
+    fi
+    if [ ${#bin_real_world_datasets[@]} -gt 0 ]; then
+        ./driver ../experiments/dtc_exp_bin.csv 5 "$NUM_RUNS" "${bin_real_world_datasets[@]}"
+    fi
+    exit 0
+fi
+
 # ====================Run the synthetic datasets ====================
 output_file_name=""
 if [ "$DEBUG" -eq 0 ] && [ ${#synthetic_datasets[@]} -gt 0 ]; then
@@ -0,0 +1,35 @@
+#include <cstdlib> // std::stoul
+#include "../../inc/experiment_driver.h" // RunRepeatedCrossValidation, WriteExperimentSummaries
+#include "../inc/proposed.h"
+
+// Usage: ./driver <output_file> <n_folds> <n_runs> <dataset> [<dataset> ...]
+// Runs every repeat and fold of each dataset inside this process instead of one ./main per fold.
+int main(int argc, char *argv[])
+{
+    if(argc < 5){
+        printf("usage: %s <output_file> <n_folds> <n_runs> <dataset> [<dataset> ...]\n", argv[0]);
+        exit(1);
+    }
+
+    const std::string output_path = argv[1];
+    const uint32_t n_folds = std::stoul(argv[2]);
+    const uint32_t n_runs  = std::stoul(argv[3]);
+
+    const struct decision_tree_parameter dtc_params = {
+        .max_purity = DTC_MAX_PURITY,
+        .min_samples_split = DTC_MIN_SAMPLES_SPLIT
+    };
+
+    ResampleFunction resample = [&dtc_params](const std::vector<std::vector<float>> &training_set, const uint32_t n_classes){
+        Proposed pro(dtc_params);
+        return pro.fit_resample(training_set, n_classes);
+    };
+
+    std::vector<ExperimentSummary> summaries;
+    for(int arg_idx = 4; arg_idx < argc; arg_idx++){
+        summaries.push_back(RunRepeatedCrossValidation("../../datasets", argv[arg_idx], n_folds, n_runs, 
+                                                            dtc_params, resample, GetNumThreads()));
+        summaries.back().algorithm_name = "proposed";
+    }
+    WriteExperimentSummaries(output_path, summaries);
+}
@@ -0,0 +1,94 @@
+#include <cstdlib> // std::stoul
+#include "../../inc/experiment_driver.h" // LoadFolds, MapFoldRows, EvaluateResampledSet, SummarizeMetrics, WriteExperimentSummaries
+#include "../../inc/distance_matrix.h"   // DistanceMatrix
+#include "../../inc/nearest_neighbors.h" // NeighborGraph
+#include "../inc/proposed.h"
+
+// Usage: ./level_sweep <output_file> <n_folds> <n_runs> <max_level> <dataset> [<dataset> ...]
+// Evaluates Proposed at every level from 1 to max_level without a rebuild per level: each run and fold resamples
+// all levels from one search of the RNN graph (Proposed::fit_resample_levels) and trains on every resampled set.
+// One CSV line is written per level, named proposed_level<level>; the running time of a level is the resampling
+// of the whole sweep plus its own training and testing.
+int main(int argc, char *argv[])
+{
+    if(argc < 6){
+        printf("usage: %s <output_file> <n_folds> <n_runs> <max_level> <dataset> [<dataset> ...]\n", argv[0]);
+        exit(1);
+    }
+
+    const std::string output_path = argv[1];
+    const uint32_t n_folds   = std::stoul(argv[2]);
+    const uint32_t n_runs    = std::stoul(argv[3]);
+    const uint32_t max_level = std::stoul(argv[4]);
+    if(max_level == 0){
+        printf("./%s:%d: error: max_level must be at least 1\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    const struct decision_tree_parameter dtc_params = {
+        .max_purity = DTC_MAX_PURITY,
+        .min_samples_split = DTC_MIN_SAMPLES_SPLIT
+    };
+
+    const uint32_t n_threads = GetNumThreads();
+    const uint32_t n_evaluations = n_runs * n_folds; // per level
+
+    std::vector<ExperimentSummary> summaries;
+    for(int arg_idx = 5; arg_idx < argc; arg_idx++){
+        const std::string dataset_name = argv[arg_idx];
+        std::vector<Dataset> folds = LoadFolds("../../datasets", dataset_name, n_folds);
+
+        // Distances and nearest neighbors of the rows of all folds, shared like in the runner
+        std::vector<std::vector<float>> full_set;
+        std::vector<std::vector<uint32_t>> fold_idxes;
+        std::unique_ptr<DistanceMatrix> full_dist_cache;
+        std::unique_ptr<NeighborGraph> neighbor_graph;
+        if(MapFoldRows(folds, full_set, fold_idxes)){
+            if(full_set.size() <= EXPERIMENT_MATRIX_MAX_DATA){
+                full_dist_cache = std::make_unique<DistanceMatrix>(full_set, n_threads);
+            }
+            neighbor_graph = std::make_unique<NeighborGraph>(full_set, GetNeighborGraphK(full_set.size()), n_threads);
+        }
+
+        std::vector<float> metrics(max_level * n_evaluations * NUM_METRICS, 0.f); // one row per (level, run, fold)
+        uint32_t n_classes = 0;
+        for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+            n_classes = std::max(n_classes, folds[fold_idx].n_classes);
+        }
+        // One accumulator per (level, thread), merged per level at the end
+        std::vector<MetricsAccumulator> accumulators(max_level * n_threads, MetricsAccumulator(n_classes));
+        ParallelFor(n_evaluations, n_threads, [&](const uint32_t eval_idx, const uint32_t thread_idx){
+            const uint32_t fold_idx = eval_idx % n_folds;
+
+            Proposed pro(dtc_params);
+            if(neighbor_graph != nullptr){
+                pro.set_distance_cache(full_dist_cache.get(), &fold_idxes[fold_idx], neighbor_graph.get());
+            }
+
+            timespec start_ns = {0}, end_ns = {0};
+            clock_gettime(EXPERIMENT_CLOCK, &start_ns);
+            const std::vector<std::vector<std::vector<float>>> resampled_sets =
+                pro.fit_resample_levels(folds[fold_idx].training_set, folds[fold_idx].n_classes, max_level);
+            clock_gettime(EXPERIMENT_CLOCK, &end_ns);
+            const float running_time_ms = (float)(end_ns.tv_sec - start_ns.tv_sec) * 1000 +
+                                            (float)(end_ns.tv_nsec - start_ns.tv_nsec) / 1000000;
+
+            for(uint32_t level = 1; level <= max_level; level++){
+                float *level_metrics = &metrics[((level - 1) * n_evaluations + eval_idx) * NUM_METRICS];
+                EvaluateResampledSet(folds[fold_idx], resampled_sets[level - 1], dtc_params, level_metrics,
+                                        &accumulators[(level - 1) * n_threads + thread_idx]);
+                level_metrics[8] += running_time_ms;
+            }
+        });
+
+        for(uint32_t level = 1; level <= max_level; level++){
+            MetricsAccumulator &accumulator = accumulators[(level - 1) * n_threads];
+            for(uint32_t thread_idx = 1; thread_idx < n_threads; thread_idx++){
+                accumulator.Merge(accumulators[(level - 1) * n_threads + thread_idx]);
+            }
+            summaries.push_back(SummarizeMetrics("proposed_level" + std::to_string(level), dataset_name,
+                                                    &metrics[(level - 1) * n_evaluations * NUM_METRICS], n_evaluations, &accumulator, n_runs));
+        }
+        WriteExperimentSummaries(output_path, summaries); // keep the finished datasets if the sweep is interrupted
+    }
+}
@@ -22,7 +22,7 @@ int main(int argc, char *argv[])
     clock_gettime(CLOCK_MONOTONIC, &start_ns);
     Proposed pro(dtc_params);
     std::vector<std::vector<float>> resampled_set = pro.fit_resample(dataset.training_set, dataset.n_classes);
-    Validation k_fold_validation(resampled_set, dataset.testing_set, dataset.n_classes, dtc_params, false);
+    Validation k_fold_validation(resampled_set, dataset.testing_set, dataset.n_classes, dtc_params, false, GetNumThreads());
     // for(uint32_t class_idx = 1; class_idx <= dataset.n_classes; class_idx++){
     //     for(uint32_t class_idx_ = 1; class_idx_ <= dataset.n_classes; class_idx_++){
     //         std::cerr << k_fold_validation.confusion_matrix[class_idx][class_idx_] << " ";
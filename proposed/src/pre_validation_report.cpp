@@ -0,0 +1,67 @@
+#include <cstdlib> // std::stoul
+#include "../../inc/experiment_driver.h" // LoadFolds
+#include "../inc/proposed.h"
+
+// Usage: ./pre_validation_report <n_folds> <n_runs> <max_rows> <dataset> [<dataset> ...]
+// Compares the pre-validation strategies of Proposed on the training set of every run and fold: prints per
+// dataset and strategy the mean time of Proposed::pre_validate and the mean MAUC it estimates, and for the
+// sampled strategies the time saved and the MAUC change against PRE_VALIDATION_HOLDOUT.
+int main(int argc, char *argv[])
+{
+    if(argc < 5){
+        printf("usage: %s <n_folds> <n_runs> <max_rows> <dataset> [<dataset> ...]\n", argv[0]);
+        exit(1);
+    }
+
+    const uint32_t n_folds  = std::stoul(argv[1]);
+    const uint32_t n_runs   = std::stoul(argv[2]);
+    const uint32_t max_rows = std::stoul(argv[3]);
+
+    const struct decision_tree_parameter dtc_params = {
+        .max_purity = DTC_MAX_PURITY,
+        .min_samples_split = DTC_MIN_SAMPLES_SPLIT
+    };
+
+    const PreValidation strategies[] = {PRE_VALIDATION_HOLDOUT, PRE_VALIDATION_SUBSAMPLE, PRE_VALIDATION_OUT_OF_BAG};
+    const char *strategy_names[] = {"holdout", "subsample", "out_of_bag"};
+    const uint32_t n_strategies = sizeof(strategies) / sizeof(strategies[0]);
+
+    printf("%-24s %-12s %8s %12s %10s %10s %12s\n", "dataset", "strategy", "rows", "time(ms)", "saved", "MAUC", "MAUC change");
+    for(int arg_idx = 4; arg_idx < argc; arg_idx++){
+        const std::string dataset_name = argv[arg_idx];
+        const std::vector<Dataset> folds = LoadFolds("../../datasets", dataset_name, n_folds);
+
+        std::vector<double> time_sums(n_strategies, 0.), MAUC_sums(n_strategies, 0.);
+        double n_rows_sum = 0.;
+        for(uint32_t run_idx = 0; run_idx < n_runs; run_idx++){
+            for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+                const Dataset &fold = folds[fold_idx];
+                n_rows_sum += fold.training_set.size();
+                for(uint32_t strategy_idx = 0; strategy_idx < n_strategies; strategy_idx++){
+                    Proposed pro(dtc_params);
+                    pro.set_pre_validation(strategies[strategy_idx], max_rows);
+
+                    timespec start_ns = {0}, end_ns = {0};
+                    clock_gettime(CLOCK_MONOTONIC, &start_ns);
+                    const std::unique_ptr<Validation> pre_valid = pro.pre_validate(fold.training_set, fold.n_classes);
+                    clock_gettime(CLOCK_MONOTONIC, &end_ns);
+
+                    time_sums[strategy_idx] += (double)(end_ns.tv_sec - start_ns.tv_sec) * 1000 +
+                                                (double)(end_ns.tv_nsec - start_ns.tv_nsec) / 1000000;
+                    MAUC_sums[strategy_idx] += pre_valid->MAUC;
+                }
+            }
+        }
+
+        const uint32_t n_evaluations = n_runs * n_folds;
+        const double holdout_time = time_sums[0] / n_evaluations;
+        const double holdout_MAUC = MAUC_sums[0] / n_evaluations;
+        for(uint32_t strategy_idx = 0; strategy_idx < n_strategies; strategy_idx++){
+            const double mean_time = time_sums[strategy_idx] / n_evaluations;
+            const double mean_MAUC = MAUC_sums[strategy_idx] / n_evaluations;
+            printf("%-24s %-12s %8.0f %12.3f %9.1f%% %10.4f %+12.4f\n", dataset_name.c_str(), strategy_names[strategy_idx],
+                    n_rows_sum / n_evaluations, mean_time, (holdout_time > 0.) ? 100. * (1. - mean_time / holdout_time) : 0.,
+                    mean_MAUC, mean_MAUC - holdout_MAUC);
+        }
+    }
+}
@@ -1,163 +1,298 @@
 #include "../inc/proposed.h"
-inline static float euclidean_dist(const std::vector<float> &src, const std::vector<float> &dst)
+float Proposed::get_distance(const uint32_t src_idx, const uint32_t dst_idx) const
 {
-    float squ_dist = 0;
-
-    // the last column of vector stores the label
-    for(uint32_t f_idx = 0; f_idx < src.size() - 1; f_idx++){
-        float diff = src[f_idx] - dst[f_idx];
-        squ_dist += diff * diff;
-    }
-
-    return sqrt(squ_dist);
+    return (dist_cache_ != nullptr) ? dist_cache_->GetDistance(get_cache_idx(src_idx), get_cache_idx(dst_idx)) : 
+                                        EuclideanDistance((*res_set_)[src_idx], (*res_set_)[dst_idx]);
 }
-void Proposed::rw_select_by_inf_scores(std::vector<bool> &selection_result, const uint32_t n_rounds)
+
+void Proposed::rw_select_by_inf_scores(const std::vector<float> &inf_scores, std::vector<bool> &selection_result, const uint32_t n_rounds)
 {
     std::random_device rd;
     std::mt19937 gen(rd());
 
-    float total_fitness = std::accumulate(inf_scores_.begin(), inf_scores_.end(), 0.f);
+    // Each round draws without replacement, so a selected row leaves the wheel in O(log N)
+    WeightedSampler sampler(inf_scores);
     for(uint32_t round = 0; round < n_rounds; round++){
-        if(total_fitness <= 0.f){
+        if(sampler.GetTotal() <= 0.){
             break;
         }
 
-        std::uniform_real_distribution<> distrib(0.f, total_fitness);
-        float random_float = distrib(gen);
-
-        uint32_t selected_ind_idx;
-        for(selected_ind_idx = 0; selected_ind_idx < res_set_->size(); selected_ind_idx++){
-            random_float -= inf_scores_[selected_ind_idx];
-            if(random_float <= 0){
-                break;
-            }
-        }
-
-        if(selected_ind_idx >= res_set_->size()){
-            selected_ind_idx = res_set_->size() - 1; // Select the last individual in case of rounding errors
-        }
-
-        total_fitness -= inf_scores_[selected_ind_idx];
-        inf_scores_[selected_ind_idx] = 0.f;
+        uint32_t selected_ind_idx = sampler.Sample(gen);
+        sampler.Remove(selected_ind_idx);
         selection_result[selected_ind_idx] = true;
     }
 }
 
-void Proposed::compute_inf_scores(const std::vector<std::vector<uint32_t>> &confusion_matrix)
+void Proposed::compute_inf_scores(const std::vector<std::vector<uint32_t>> &confusion_matrix, const uint32_t n_levels)
 { 
-    inf_scores_.resize(res_set_->size(), 0.f);
-
-    std::vector<uint32_t> instance_queue;
+    const uint32_t n_data = res_set_->size();
+    level_inf_scores_.assign(n_levels + 1, std::vector<float>(n_data, 0.f));
 
-    std::vector<bool> is_visited(res_set_->size());
-    for(uint32_t src_idx = 0; src_idx < res_set_->size(); src_idx++){
+    // Every source runs its own breadth-first search, so the sources are split between threads. A row is visited
+    // in the search of src_idx when its stamp is src_idx + 1, so the marks of a thread are never cleared, and a
+    // level of the search is a range of the queue, which is only appended to because every row enters it once.
+    const uint32_t n_threads = std::max(n_threads_, 1u);
+    std::vector<std::vector<uint32_t>> visit_stamps(n_threads, std::vector<uint32_t>(n_data, 0));
+    std::vector<std::vector<uint32_t>> instance_queues(n_threads);
+    ParallelFor(n_data, n_threads, [&](const uint32_t src_idx, const uint32_t thread_idx){
+        std::vector<uint32_t> &visit_stamp = visit_stamps[thread_idx];
+        std::vector<uint32_t> &instance_queue = instance_queues[thread_idx];
+        const uint32_t stamp = src_idx + 1;
         uint32_t src_label = (*res_set_)[src_idx][label_idx_];
 
-        std::fill(is_visited.begin(), is_visited.end(), false);
-
         uint32_t n_pos_RNNs = 0, n_neg_RNNs = 0;
         float pos_dist_sum = 0.f, neg_dist_sum = 0.f;
+        level_inf_scores_[0][src_idx] = get_inf_score(src_label, n_pos_RNNs, n_neg_RNNs, pos_dist_sum, neg_dist_sum);
 
+        instance_queue.clear();
         instance_queue.emplace_back(src_idx);
-        is_visited[src_idx] = true;
+        visit_stamp[src_idx] = stamp;
 
-        for(uint32_t level = 0; level < PROPOSED_LEVEL; level++){
-            uint32_t current_q_size = instance_queue.size();
-            for(uint32_t q_idx = 0; q_idx < current_q_size; q_idx++){
+        // The search of a level extends that of the level before, so the counts and sums are scored after every level
+        uint32_t level_begin = 0;
+        for(uint32_t level = 0; level < n_levels; level++){
+            const uint32_t level_end = instance_queue.size();
+            for(uint32_t q_idx = level_begin; q_idx < level_end; q_idx++){
                 uint32_t data_idx = instance_queue[q_idx];
-                for(uint32_t idx = 0; idx < RNN[data_idx].size(); idx++){
-                    uint32_t rnn_idx   = RNN[data_idx][idx];
+                for(uint32_t idx = RNN_.offsets[data_idx]; idx < RNN_.offsets[data_idx + 1]; idx++){
+                    uint32_t rnn_idx   = RNN_.idxes[idx];
                     uint32_t rnn_label = (*res_set_)[rnn_idx][label_idx_];
-                    if(!is_visited[rnn_idx]){
-                        if(level < (PROPOSED_LEVEL - 1)){ // last level is not expanded
+                    if(visit_stamp[rnn_idx] != stamp){
+                        if(level + 1 < n_levels){ // last level is not expanded
                             instance_queue.emplace_back(rnn_idx);
                         }
-                        is_visited[rnn_idx] = true;
+                        visit_stamp[rnn_idx] = stamp;
  
                         if(rnn_label == src_label){
                             n_pos_RNNs++;
-                            pos_dist_sum += (*dist_mat_)[src_idx][rnn_idx].second;
+                            pos_dist_sum += (level == 0) ? RNN_.dists[idx] : get_distance(src_idx, rnn_idx);
                         }
-                        else{
-                            float FNR_dst_to_src = static_cast<float>(confusion_matrix[src_label][rnn_label]) / 
-                                                        class_cnts_[rnn_label];
-                            float FNR_src_to_dst = static_cast<float>(confusion_matrix[rnn_label][src_label]) /
-                                                        class_cnts_[src_label];
-                            
-                            if(FNR_dst_to_src > FNR_src_to_dst){
-                                n_neg_RNNs++;
-                                neg_dist_sum += (*dist_mat_)[src_idx][rnn_idx].second;
-                            }
+                        else if(is_harmful(src_label, rnn_label, confusion_matrix)){
+                            n_neg_RNNs++;
+                            neg_dist_sum += (level == 0) ? RNN_.dists[idx] : get_distance(src_idx, rnn_idx);
                         }
                     }
                 }
             }
-            instance_queue.erase(instance_queue.begin(), instance_queue.begin() + current_q_size);
+            level_begin = level_end;
+            level_inf_scores_[level + 1][src_idx] = get_inf_score(src_label, n_pos_RNNs, n_neg_RNNs, pos_dist_sum, neg_dist_sum);
         }
-        instance_queue.clear();
+    });
+}
+
+void Proposed::compute_inf_scores_ms_bfs(const std::vector<std::vector<uint32_t>> &confusion_matrix, const uint32_t n_levels)
+{
+    const uint32_t n_data = res_set_->size();
+    level_inf_scores_.assign(n_levels + 1, std::vector<float>());
+    std::vector<float> &inf_scores = level_inf_scores_[n_levels]; // only the last level is scored
+    inf_scores.resize(n_data, 0.f);
 
-        float pos_inf_score = 0.f, neg_inf_score = 0.f;
-        if(n_pos_RNNs > 0 && pos_dist_sum > 0){
-            float avg_pos_dist = pos_dist_sum / n_pos_RNNs;
-            pos_inf_score = (float)(n_pos_RNNs) / (n_pos_RNNs + n_neg_RNNs) / avg_pos_dist;
+    // Sources are batched in breadth-first order of the RNN graph, so that the sources of a word are close
+    // together and share most of their frontiers
+    std::vector<uint32_t> src_order;
+    src_order.reserve(n_data);
+    std::vector<bool> is_ordered(n_data, false);
+    for(uint32_t root_idx = 0; root_idx < n_data; root_idx++){
+        if(is_ordered[root_idx]){
+            continue;
         }
-        if(n_neg_RNNs > 0 && neg_dist_sum > 0){
-            float avg_neg_dist = neg_dist_sum / n_neg_RNNs;
-            neg_inf_score = (float)(n_neg_RNNs) / (n_pos_RNNs + n_neg_RNNs) / avg_neg_dist;
+        is_ordered[root_idx] = true;
+        src_order.push_back(root_idx);
+        for(uint32_t order_idx = src_order.size() - 1; order_idx < src_order.size(); order_idx++){
+            for(uint32_t idx = RNN_.offsets[src_order[order_idx]]; idx < RNN_.offsets[src_order[order_idx] + 1]; idx++){
+                const uint32_t rnn_idx = RNN_.idxes[idx];
+                if(!is_ordered[rnn_idx]){
+                    is_ordered[rnn_idx] = true;
+                    src_order.push_back(rnn_idx);
+                }
+            }
         }
-        
-        float epsilon = 1e-7;
-        inf_scores_[src_idx] = (neg_inf_score) / (pos_inf_score + epsilon) * log2(class_cnts_[src_label]);
     }
+
+    // Bit b of a word of a row stands for the source src_order[batch_begin + b]. seen marks the sources that reached
+    // the row, first_hop those that reached it at level 0 and frontier those that expand it at the current level.
+    // Only the touched rows are cleared after a batch.
+    typedef struct BatchState{
+        std::vector<uint64_t> seen, first_hop, frontier, next_frontier;
+        std::vector<uint32_t> active, next_active, touched;
+    }BatchState;
+    const uint32_t n_threads = std::max(n_threads_, 1u);
+    const uint32_t n_batches = (n_data + PROPOSED_MS_BFS_WIDTH - 1) / PROPOSED_MS_BFS_WIDTH;
+    std::vector<BatchState> states(n_threads, {.seen = std::vector<uint64_t>(n_data, 0), .first_hop = std::vector<uint64_t>(n_data, 0),
+                                                .frontier = std::vector<uint64_t>(n_data, 0), .next_frontier = std::vector<uint64_t>(n_data, 0),
+                                                .active = {}, .next_active = {}, .touched = {}});
+    ParallelFor(n_batches, n_threads, [&](const uint32_t batch_idx, const uint32_t thread_idx){
+        BatchState &state = states[thread_idx];
+        const uint32_t batch_begin = batch_idx * PROPOSED_MS_BFS_WIDTH;
+        const uint32_t batch_size = std::min(n_data - batch_begin, (uint32_t)PROPOSED_MS_BFS_WIDTH);
+
+        for(uint32_t bit = 0; bit < batch_size; bit++){
+            const uint32_t src_idx = src_order[batch_begin + bit];
+            state.seen[src_idx] = state.frontier[src_idx] = (uint64_t)1 << bit;
+            state.active.push_back(src_idx);
+            state.touched.push_back(src_idx);
+        }
+
+        for(uint32_t level = 0; level < n_levels; level++){
+            const bool is_expanded = level + 1 < n_levels; // last level is not expanded
+            for(const uint32_t data_idx : state.active){
+                const uint64_t sources = state.frontier[data_idx];
+                state.frontier[data_idx] = 0;
+                for(uint32_t idx = RNN_.offsets[data_idx]; idx < RNN_.offsets[data_idx + 1]; idx++){
+                    const uint32_t rnn_idx = RNN_.idxes[idx];
+                    const uint64_t new_sources = sources & ~state.seen[rnn_idx];
+                    if(new_sources == 0){
+                        continue;
+                    }
+                    if(state.seen[rnn_idx] == 0){
+                        state.touched.push_back(rnn_idx);
+                    }
+                    state.seen[rnn_idx] |= new_sources;
+                    if(level == 0){
+                        state.first_hop[rnn_idx] |= new_sources;
+                    }
+                    if(is_expanded){
+                        if(state.next_frontier[rnn_idx] == 0){
+                            state.next_active.push_back(rnn_idx);
+                        }
+                        state.next_frontier[rnn_idx] |= new_sources;
+                    }
+                }
+            }
+            state.active.swap(state.next_active);
+            state.next_active.clear();
+            state.frontier.swap(state.next_frontier);
+        }
+        for(const uint32_t data_idx : state.active){ // when n_levels is 0
+            state.frontier[data_idx] = 0;
+        }
+        state.active.clear();
+
+        // first hops in RNN order with their stored distances, like the per-source search, then the rest by ascending row
+        uint32_t n_pos_RNNs[PROPOSED_MS_BFS_WIDTH] = {0}, n_neg_RNNs[PROPOSED_MS_BFS_WIDTH] = {0};
+        float pos_dist_sums[PROPOSED_MS_BFS_WIDTH] = {0}, neg_dist_sums[PROPOSED_MS_BFS_WIDTH] = {0};
+        for(uint32_t bit = 0; bit < batch_size && n_levels > 0; bit++){
+            const uint32_t src_idx = src_order[batch_begin + bit];
+            const uint32_t src_label = (*res_set_)[src_idx][label_idx_];
+            for(uint32_t idx = RNN_.offsets[src_idx]; idx < RNN_.offsets[src_idx + 1]; idx++){
+                const uint32_t rnn_label = (*res_set_)[RNN_.idxes[idx]][label_idx_];
+                if(rnn_label == src_label){
+                    n_pos_RNNs[bit]++;
+                    pos_dist_sums[bit] += RNN_.dists[idx];
+                }
+                else if(is_harmful(src_label, rnn_label, confusion_matrix)){
+                    n_neg_RNNs[bit]++;
+                    neg_dist_sums[bit] += RNN_.dists[idx];
+                }
+            }
+        }
+
+        std::sort(state.touched.begin(), state.touched.end());
+        for(const uint32_t rnn_idx : state.touched){
+            const uint32_t rnn_label = (*res_set_)[rnn_idx][label_idx_];
+            uint64_t sources = state.seen[rnn_idx] & ~state.first_hop[rnn_idx];
+            state.seen[rnn_idx] = state.first_hop[rnn_idx] = 0;
+            for(; sources != 0; sources &= sources - 1){
+                const uint32_t bit = __builtin_ctzll(sources);
+                const uint32_t src_idx = src_order[batch_begin + bit];
+                if(src_idx == rnn_idx){
+                    continue;
+                }
+
+                const uint32_t src_label = (*res_set_)[src_idx][label_idx_];
+                if(rnn_label == src_label){
+                    n_pos_RNNs[bit]++;
+                    pos_dist_sums[bit] += get_distance(src_idx, rnn_idx);
+                }
+                else if(is_harmful(src_label, rnn_label, confusion_matrix)){
+                    n_neg_RNNs[bit]++;
+                    neg_dist_sums[bit] += get_distance(src_idx, rnn_idx);
+                }
+            }
+        }
+        state.touched.clear();
+
+        for(uint32_t bit = 0; bit < batch_size; bit++){
+            const uint32_t src_idx = src_order[batch_begin + bit];
+            inf_scores[src_idx] = get_inf_score((*res_set_)[src_idx][label_idx_], n_pos_RNNs[bit], n_neg_RNNs[bit],
+                                                    pos_dist_sums[bit], neg_dist_sums[bit]);
+        }
+    });
 }
 
-void Proposed::find_RNN(void)
+// Whether a neighbor of another class is misclassified as the source class more often than the reverse
+bool Proposed::is_harmful(const uint32_t src_label, const uint32_t rnn_label, const std::vector<std::vector<uint32_t>> &confusion_matrix) const
 {
-    dist_mat_ = std::make_unique<std::vector<std::vector<std::pair<uint32_t, float>>>>(
-        res_set_->size(),
-        std::vector<std::pair<uint32_t, float>>(res_set_->size(), {0, 0.f})
-    );
+    float FNR_dst_to_src = static_cast<float>(confusion_matrix[src_label][rnn_label]) / 
+                                class_cnts_[rnn_label];
+    float FNR_src_to_dst = static_cast<float>(confusion_matrix[rnn_label][src_label]) /
+                                class_cnts_[src_label];
 
-    for(uint32_t src_idx = 0; src_idx < res_set_->size(); src_idx++){
-        (*dist_mat_)[src_idx][src_idx] = {src_idx, std::numeric_limits<float>::max()};
-        for(uint32_t dst_idx = src_idx + 1; dst_idx < res_set_->size(); dst_idx++){
-            float dist = euclidean_dist((*res_set_)[src_idx], (*res_set_)[dst_idx]);
-            (*dist_mat_)[src_idx][dst_idx] = {dst_idx, dist};
-            (*dist_mat_)[dst_idx][src_idx] = {src_idx, dist};
-        }
+    return FNR_dst_to_src > FNR_src_to_dst;
+}
+
+float Proposed::get_inf_score(const uint32_t src_label, const uint32_t n_pos_RNNs, const uint32_t n_neg_RNNs,
+                                const float pos_dist_sum, const float neg_dist_sum) const
+{
+    float pos_inf_score = 0.f, neg_inf_score = 0.f;
+    if(n_pos_RNNs > 0 && pos_dist_sum > 0){
+        float avg_pos_dist = pos_dist_sum / n_pos_RNNs;
+        pos_inf_score = (float)(n_pos_RNNs) / (n_pos_RNNs + n_neg_RNNs) / avg_pos_dist;
+    }
+    if(n_neg_RNNs > 0 && neg_dist_sum > 0){
+        float avg_neg_dist = neg_dist_sum / n_neg_RNNs;
+        neg_inf_score = (float)(n_neg_RNNs) / (n_pos_RNNs + n_neg_RNNs) / avg_neg_dist;
     }
     
-    RNN.resize(res_set_->size());
+    float epsilon = 1e-7;
+    return (neg_inf_score) / (pos_inf_score + epsilon) * log2(class_cnts_[src_label]);
+}
+
+void Proposed::find_RNN(void)
+{
+    // Only the k_max nearest neighbors of each sample are needed, so they are searched block by block
+    // instead of sorting full rows of an N x N distance matrix.
+    std::vector<uint32_t> ks(res_set_->size());
     for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){
         uint32_t label = (*res_set_)[data_idx][label_idx_];
-        RNN[data_idx].reserve(k_max_[label]);
+        ks[data_idx] = k_max_[label];
     }
+    const NeighborLists knn = find_k_nearest_neighbors(*res_set_, ks, cache_idxes_, n_threads_);
 
+    // The adaptive k of every sample keeps a prefix of its neighbors, whose reverse edges form the RNN graph
+    std::vector<uint32_t> n_kept(res_set_->size(), 0);
     for(uint32_t src_idx = 0; src_idx < res_set_->size(); src_idx++){
-        const uint32_t src_label = (*res_set_)[src_idx][label_idx_];
-        std::vector<std::pair<uint32_t, float>> knn(k_max_[src_label], {0, 0.f});
-        std::partial_sort_copy((*dist_mat_)[src_idx].begin(), (*dist_mat_)[src_idx].end(),
-                                    knn.begin(), knn.end(),          
-                                        [](const std::pair<uint32_t, float> &a, const std::pair<uint32_t, float> &b){return a.second < b.second;});
+        n_kept[src_idx] = count_kept_neighbors(src_idx, knn.GetNumNeighbors(src_idx), [&](const uint32_t k){
+            return knn.idxes[knn.offsets[src_idx] + k];
+        });
+    }
+    RNN_ = ReverseNeighbors(knn, n_kept, res_set_->size());
+}
 
-        uint32_t n_same_class_nns = 0;
-        for(uint32_t k = 0; k < k_max_[src_label]; k++){
-            uint32_t nn_idx   = knn[k].first;
-            uint32_t nn_label = (*res_set_)[nn_idx][label_idx_];
+// Adaptive k of a sample among its n_neighbors nearest ones, the k-th of which is get_neighbor_idx(k - 1)
+template<typename NeighborIdx>
+uint32_t Proposed::count_kept_neighbors(const uint32_t src_idx, const uint32_t n_neighbors, const NeighborIdx &get_neighbor_idx) const
+{
+    const uint32_t src_label = (*res_set_)[src_idx][label_idx_];
 
-            if(nn_label == src_label){
-                n_same_class_nns++;
-            }
+    uint32_t n_kept = 0, n_same_class_nns = 0;
+    for(uint32_t k = 0; k < n_neighbors; k++){
+        uint32_t nn_label = (*res_set_)[get_neighbor_idx(k)][label_idx_];
 
-            // Adaptive k ranges from 3 to k_max for each sample.
-            // Break if the ratio of same-class nearest neighbors to the current k is less than 0.5.
-            if((float)n_same_class_nns / (k + 1) <= 0.5 && (k + 1) >= 3){ // scan nns >= 3
-                break;
-            } 
-            
-            RNN[nn_idx].emplace_back(src_idx);
+        if(nn_label == src_label){
+            n_same_class_nns++;
         }
+
+        // Adaptive k ranges from 3 to k_max for each sample.
+        // Break if the ratio of same-class nearest neighbors to the current k is less than 0.5.
+        if((float)n_same_class_nns / (k + 1) <= 0.5 && (k + 1) >= 3){ // scan nns >= 3
+            break;
+        } 
+        
+        n_kept++;
     }
+
+    return n_kept;
 }
 
 void Proposed::compute_kmax(void)
@@ -169,47 +304,456 @@ void Proposed::compute_kmax(void)
     }
 }
 
+std::unique_ptr<Validation> Proposed::pre_validate(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes) const
+{
+    std::vector<std::vector<float>> pre_tra_set, pre_tst_set;
+    if(pre_validation_ == PRE_VALIDATION_HOLDOUT){
+        TrainTestSplit(tra_set, 0.7, pre_tra_set, pre_tst_set, n_classes);
+        return std::make_unique<Validation>(pre_tra_set, pre_tst_set, n_classes, dtc_params_, true);
+    }
+    else if(pre_validation_ == PRE_VALIDATION_SUBSAMPLE){
+        std::vector<uint32_t> sampled_idxes;
+        std::vector<std::vector<float>> sampled_set;
+        StratifiedSubsampleIdxes(tra_set, pre_validation_max_rows_, sampled_idxes, n_classes);
+        GatherData(tra_set, sampled_idxes, sampled_set);
+        TrainTestSplit(sampled_set, 0.7, pre_tra_set, pre_tst_set, n_classes);
+        return std::make_unique<Validation>(pre_tra_set, pre_tst_set, n_classes, dtc_params_, true);
+    }
+
+    // Out-of-bag probabilities averaged over the trees that did not train on a row; rows every tree trained on are not tested
+    const uint32_t label_idx = tra_set[0].size() - 1;
+    const uint32_t bootstrap_size = std::max(pre_validation_max_rows_ / PROPOSED_PRE_VALIDATION_TREES, 1u);
+    std::vector<float> predict_prob(tra_set.size() * (n_classes + 1), 0.f);
+    std::vector<uint32_t> n_votes(tra_set.size(), 0);
+    std::vector<bool> is_in_bag(tra_set.size());
+    std::vector<uint32_t> bootstrap_idxes;
+    for(uint32_t tree_idx = 0; tree_idx < PROPOSED_PRE_VALIDATION_TREES; tree_idx++){
+        StratifiedBootstrapIdxes(tra_set, bootstrap_size, bootstrap_idxes, n_classes);
+        pre_tra_set.clear();
+        GatherData(tra_set, bootstrap_idxes, pre_tra_set);
+        const DecisionTreeClassifier dtc(pre_tra_set, n_classes, dtc_params_);
+
+        is_in_bag.assign(tra_set.size(), false);
+        for(const uint32_t data_idx : bootstrap_idxes){
+            is_in_bag[data_idx] = true;
+        }
+        for(uint32_t data_idx = 0; data_idx < tra_set.size(); data_idx++){
+            if(!is_in_bag[data_idx]){
+                const std::vector<float> &leaf_prob = dtc.GetLeafPredictProb(tra_set[data_idx]);
+                for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+                    predict_prob[data_idx * (n_classes + 1) + class_idx] += leaf_prob[class_idx];
+                }
+                n_votes[data_idx]++;
+            }
+        }
+    }
+
+    std::vector<float> oob_predict_prob;
+    std::vector<uint32_t> ground_truth;
+    oob_predict_prob.reserve(predict_prob.size());
+    ground_truth.reserve(tra_set.size());
+    for(uint32_t data_idx = 0; data_idx < tra_set.size(); data_idx++){
+        if(n_votes[data_idx] > 0){
+            for(uint32_t class_idx = 0; class_idx <= n_classes; class_idx++){
+                oob_predict_prob.push_back(predict_prob[data_idx * (n_classes + 1) + class_idx] / n_votes[data_idx]);
+            }
+            ground_truth.push_back(tra_set[data_idx][label_idx]);
+        }
+    }
+
+    return std::make_unique<Validation>(oob_predict_prob, ground_truth, n_classes, true);
+}
+
 std::vector<std::vector<float>> Proposed::fit_resample(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes)
 {
+    return std::move(resample_levels(tra_set, n_classes, level_, false).back());
+}
+
+std::vector<std::vector<std::vector<float>>> Proposed::fit_resample_levels(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes, 
+                                                                            const uint32_t max_level)
+{
+    return resample_levels(tra_set, n_classes, max_level, true);
+}
+
+std::vector<std::vector<std::vector<float>>> Proposed::resample_levels(const std::vector<std::vector<float>> &tra_set, const uint32_t n_classes, 
+                                                                        const uint32_t max_level, const bool all_levels)
+{
+    reset_incremental();
     label_idx_ = tra_set[0].size() - 1;
     n_classes_ = n_classes;
     res_set_ = std::make_unique<std::vector<std::vector<float>>>(tra_set);
 
-    class_cnts_.resize(n_classes + 1, 0);
+    check_distance_cache(res_set_->size());
+
+    class_cnts_.assign(n_classes + 1, 0);
     for(uint32_t data_idx = 0; data_idx < res_set_->size(); data_idx++){   
         uint32_t label = (*res_set_)[data_idx][label_idx_];
         class_cnts_[label]++;
     }
 
+    const uint32_t first_level = all_levels ? std::min(1u, max_level) : max_level;
+    const uint32_t n_res_sets = max_level - first_level + 1;
     if(*std::max_element(class_cnts_.begin() + 1, class_cnts_.end()) / *std::min_element(class_cnts_.begin() + 1, class_cnts_.end()) < 1.5){
-        return *res_set_;
+        return std::vector<std::vector<std::vector<float>>>(n_res_sets, *res_set_);
     }
      
-    std::vector<std::vector<float>> pre_tra_set, pre_tst_set;
-    train_test_split(tra_set, 0.7, pre_tra_set, pre_tst_set, n_classes_);
-    Validation pre_valid(pre_tra_set, pre_tst_set, n_classes_, dtc_params_, true);
+    const std::unique_ptr<Validation> pre_valid_ptr = pre_validate(tra_set, n_classes_);
+    const Validation &pre_valid = *pre_valid_ptr;
 
     compute_kmax();
     find_RNN();
-    compute_inf_scores(pre_valid.confusion_matrix);
+    if(inf_score_engine_ == INF_SCORE_MS_BFS && !all_levels){
+        compute_inf_scores_ms_bfs(pre_valid.confusion_matrix, max_level);
+    }
+    else{
+        compute_inf_scores(pre_valid.confusion_matrix, max_level);
+    }
+
+    std::vector<std::vector<std::vector<float>>> res_sets(n_res_sets);
+    for(uint32_t level = first_level; level <= max_level; level++){
+        res_sets[level - first_level] = select_resampled_set(level_inf_scores_[level], pre_valid.MAUC);
+    }
 
-    uint32_t n_removed = res_set_->size() * (1 - pre_valid.MAUC);
-    uint32_t n_removed_candi = std::count_if(inf_scores_.begin(), inf_scores_.end(), 
+    return res_sets;
+}
+
+// Rows of res_set_ left after removing (1 - MAUC) of them, at most the rows of positive score, drawn by their scores
+std::vector<std::vector<float>> Proposed::select_resampled_set(const std::vector<float> &inf_scores, const float MAUC)
+{
+    uint32_t n_removed = res_set_->size() * (1 - MAUC);
+    uint32_t n_removed_candi = std::count_if(inf_scores.begin(), inf_scores.end(), 
                                                     [](float score){return score > 0.f;}); 
     if(n_removed > n_removed_candi){
         n_removed = n_removed_candi;
     }
-    std::vector<bool> is_removed(tra_set.size(), false);
-    rw_select_by_inf_scores(is_removed, n_removed);
-    
-    for(int data_idx = (res_set_->size() - 1); data_idx >= 0; data_idx--){
-        if(is_removed[data_idx]){
-            res_set_->erase(res_set_->begin() + data_idx);
+    std::vector<bool> is_kept(res_set_->size(), false);
+    rw_select_by_inf_scores(inf_scores, is_kept, n_removed);
+    is_kept.flip(); // the selected rows are the removed ones
+
+    std::vector<std::vector<float>> res_set = *res_set_;
+    CompactRows(res_set, is_kept);
+    return res_set;
+}
+
+void Proposed::reset_incremental(void)
+{
+    std::vector<std::vector<std::pair<float, uint32_t>>>().swap(knn_lists_);
+    std::vector<uint32_t>().swap(knn_caps_);
+    std::vector<uint32_t>().swap(n_kept_);
+    std::vector<uint32_t>().swap(rnn_label_cnts_);
+    std::vector<float>().swap(rnn_label_dist_sums_);
+    scored_level_ = 0;
+    if(res_set_ != nullptr){
+        res_set_->clear();
+    }
+}
+
+std::vector<std::vector<float>> Proposed::fit_resample_incremental(const std::vector<std::vector<float>> &new_rows, const uint32_t n_classes)
+{
+    if(dist_cache_ != nullptr){
+        printf("./%s:%d: error: incremental resampling does not read a distance cache\n", __FILE__, __LINE__);
+        exit(1);
+    }
+    if(res_set_ == nullptr || res_set_->empty()){
+        res_set_ = std::make_unique<std::vector<std::vector<float>>>();
+        n_classes_ = n_classes;
+        class_cnts_.assign(n_classes + 1, 0);
+    }
+    else if(n_classes != n_classes_){
+        printf("./%s:%d: error: the number of classes changed between incremental batches\n", __FILE__, __LINE__);
+        exit(1);
+    }
+    if(new_rows.empty() && res_set_->empty()){
+        return {};
+    }
+
+    res_set_->insert(res_set_->end(), new_rows.begin(), new_rows.end());
+    label_idx_ = (*res_set_)[0].size() - 1;
+    for(const std::vector<float> &row : new_rows){
+        class_cnts_[(uint32_t)row[label_idx_]]++;
+    }
+
+    // Rows appended while the set is balanced, or while a class has no rows yet, are searched by the first call that
+    // resamples
+    const uint32_t min_class_cnt = *std::min_element(class_cnts_.begin() + 1, class_cnts_.end());
+    const uint32_t max_class_cnt = *std::max_element(class_cnts_.begin() + 1, class_cnts_.end());
+    if(min_class_cnt == 0 || (float)max_class_cnt / min_class_cnt < 1.5f){
+        return *res_set_;
+    }
+
+    const std::unique_ptr<Validation> pre_valid = pre_validate(*res_set_, n_classes_);
+
+    // Rows whose RNN list changed, which reach every source whose neighborhood changed within level_ - 1 hops
+    // backwards, i.e. along the kept nearest neighbors
+    const uint32_t n_data = res_set_->size();
+    const uint32_t n_scored = rnn_label_cnts_.size() / (n_classes_ + 1);
+    const std::vector<uint32_t> changed_idxes = update_knn_lists();
+
+    std::vector<uint32_t> src_idxes;
+    if(scored_level_ != level_ || n_scored == 0){
+        src_idxes.resize(n_data);
+        std::iota(src_idxes.begin(), src_idxes.end(), 0);
+    }
+    else{
+        std::vector<bool> is_src(n_data, false);
+        for(uint32_t data_idx = n_scored; data_idx < n_data; data_idx++){
+            is_src[data_idx] = true;
+            src_idxes.push_back(data_idx);
+        }
+        for(const uint32_t data_idx : changed_idxes){
+            if(!is_src[data_idx] && level_ > 0){
+                is_src[data_idx] = true;
+                src_idxes.push_back(data_idx);
+            }
+        }
+        uint32_t level_begin = 0;
+        for(uint32_t level = 1; level < level_; level++){
+            const uint32_t level_end = src_idxes.size();
+            for(uint32_t q_idx = level_begin; q_idx < level_end; q_idx++){
+                const uint32_t data_idx = src_idxes[q_idx];
+                for(uint32_t k = 0; k < n_kept_[data_idx]; k++){
+                    const uint32_t nn_idx = knn_lists_[data_idx][k].second;
+                    if(!is_src[nn_idx]){
+                        is_src[nn_idx] = true;
+                        src_idxes.push_back(nn_idx);
+                    }
+                }
+            }
+            level_begin = level_end;
         }
     }
+    PDEBUG("incremental: %u rows, %zu changed RNN lists, %zu sources searched again\n", n_data, changed_idxes.size(), src_idxes.size());
+
+    compute_rnn_label_sums(src_idxes, level_);
+    compute_inf_scores_by_label(pre_valid->confusion_matrix, level_);
 
-    return *res_set_;
+    return select_resampled_set(level_inf_scores_[level_], pre_valid->MAUC);
 }
 
+// Brings knn_lists_ and n_kept_ up to the rows of res_set_ and the k_max of the current class counts, and RNN_ with them.
+// A list holds the nearest rows up to its capacity, which leaves room for its class to grow by PROPOSED_INCREMENTAL_K_HEADROOM,
+// so its first k_max rows are those find_RNN would find. New rows are searched against all rows and every old row merges
+// the new rows into its list, block by block of new rows whose distances to all rows are computed once for both; an old
+// row whose k_max outgrew its capacity is searched again. Returns the rows whose RNN list changed, i.e. that entered or
+// left the kept prefix of a row, with the new rows.
+std::vector<uint32_t> Proposed::update_knn_lists(void)
+{
+    const uint32_t n_data = res_set_->size();
+    const uint32_t n_searched = knn_lists_.size();
+    const uint32_t n_threads = std::max(n_threads_, 1u);
+    compute_kmax();
+
+    std::vector<uint32_t> ks(n_data); // k_max of every row, at most the other rows
+    std::vector<uint32_t> query_idxes;
+    knn_caps_.resize(n_data, 0);
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        const uint32_t label = (*res_set_)[data_idx][label_idx_];
+        ks[data_idx] = std::min(k_max_[label], n_data - 1);
+        if(data_idx >= n_searched || k_max_[label] > knn_caps_[data_idx]){
+            knn_caps_[data_idx] = ceil(sqrt(PROPOSED_INCREMENTAL_K_HEADROOM * class_cnts_[label]));
+            query_idxes.push_back(data_idx);
+        }
+    }
 
+    std::vector<std::vector<uint32_t>> old_kept(n_data);
+    std::vector<uint32_t> changed_idxes;
+    if(n_searched == 0){
+        std::vector<uint32_t> caps(n_data);
+        for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+            caps[data_idx] = std::min(knn_caps_[data_idx], n_data - 1);
+        }
+        // exact even under NEIGHBOR_SEARCH_HNSW, since later batches merge exact distances into the lists
+        const NeighborLists knn = find_k_nearest_neighbors(*res_set_, caps, nullptr, n_threads_, true);
+        knn_lists_.resize(n_data);
+        for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+            for(uint32_t idx = knn.offsets[data_idx]; idx < knn.offsets[data_idx + 1]; idx++){
+                knn_lists_[data_idx].emplace_back(knn.dists[idx], knn.idxes[idx]);
+            }
+        }
+    }
+    else{
+        // Kept prefixes before the update, to find the rows that entered or left them
+        for(uint32_t data_idx = 0; data_idx < n_searched; data_idx++){
+            for(uint32_t k = 0; k < n_kept_[data_idx]; k++){
+                old_kept[data_idx].push_back(knn_lists_[data_idx][k].second);
+            }
+        }
 
+        // Distances of a query to all rows in the order of SquareDistance, so they equal EuclideanDistance
+        const DistancePanels panels(*res_set_);
+        const uint32_t stride = DistancePanels::GetBlockStride(0, n_data);
+        auto search = [&](const uint32_t query_idx, float *query_dists){
+            panels.ComputeSquareDistances((*res_set_)[query_idx].data(), 0, n_data, query_dists);
+            std::vector<std::pair<float, uint32_t>> heap;
+            for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+                query_dists[data_idx] = sqrt(query_dists[data_idx]);
+                if(data_idx != query_idx){
+                    PushNeighbor(heap, knn_caps_[query_idx], {query_dists[data_idx], data_idx});
+                }
+            }
+            std::sort_heap(heap.begin(), heap.end());
+            knn_lists_[query_idx].swap(heap);
+        };
+
+        std::vector<bool> is_requeried(n_data, false);
+        std::vector<uint32_t> requery_idxes;
+        for(const uint32_t query_idx : query_idxes){
+            is_requeried[query_idx] = true;
+            if(query_idx < n_searched){
+                requery_idxes.push_back(query_idx);
+            }
+        }
+        knn_lists_.resize(n_data);
+        std::vector<std::vector<float>> thread_dists(n_threads, std::vector<float>(stride));
+        ParallelFor(requery_idxes.size(), n_threads, [&](const uint32_t q_idx, const uint32_t thread_idx){
+            search(requery_idxes[q_idx], thread_dists[thread_idx].data());
+        });
+
+        std::vector<float> block_dists((size_t)KNN_QUERY_BLOCK_SIZE * stride);
+        for(uint32_t block_begin = n_searched; block_begin < n_data; block_begin += KNN_QUERY_BLOCK_SIZE){
+            const uint32_t block_end = std::min(block_begin + KNN_QUERY_BLOCK_SIZE, n_data);
+            ParallelFor(block_end - block_begin, n_threads, [&](const uint32_t b_idx, const uint32_t){
+                search(block_begin + b_idx, &block_dists[(size_t)b_idx * stride]);
+            });
+
+            // The new rows of the block come after every row of an old list, so they are inserted by ascending row
+            ParallelFor(n_searched, n_threads, [&](const uint32_t data_idx, const uint32_t){
+                if(is_requeried[data_idx]){
+                    return;
+                }
+                std::vector<std::pair<float, uint32_t>> &neighbors = knn_lists_[data_idx];
+                for(uint32_t query_idx = block_begin; query_idx < block_end; query_idx++){
+                    const std::pair<float, uint32_t> candidate = {block_dists[(size_t)(query_idx - block_begin) * stride + data_idx], query_idx};
+                    if(neighbors.size() < knn_caps_[data_idx] || candidate < neighbors.back()){
+                        neighbors.insert(std::upper_bound(neighbors.begin(), neighbors.end(), candidate), candidate);
+                        if(neighbors.size() > knn_caps_[data_idx]){
+                            neighbors.pop_back();
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    // Rows in the symmetric difference of the old and new kept prefix of a row are the rows whose RNN list changed
+    n_kept_.resize(n_data, 0);
+    std::vector<std::vector<uint32_t>> thread_changed(n_threads);
+    ParallelFor(n_data, n_threads, [&](const uint32_t data_idx, const uint32_t thread_idx){
+        n_kept_[data_idx] = count_kept_neighbors(data_idx, ks[data_idx], [&](const uint32_t k){
+            return knn_lists_[data_idx][k].second;
+        });
+        std::vector<uint32_t> new_kept(n_kept_[data_idx]);
+        for(uint32_t k = 0; k < n_kept_[data_idx]; k++){
+            new_kept[k] = knn_lists_[data_idx][k].second;
+        }
+        std::sort(new_kept.begin(), new_kept.end());
+        std::sort(old_kept[data_idx].begin(), old_kept[data_idx].end());
+        std::set_symmetric_difference(old_kept[data_idx].begin(), old_kept[data_idx].end(), new_kept.begin(), new_kept.end(),
+                                        std::back_inserter(thread_changed[thread_idx]));
+    });
+    std::vector<bool> is_changed(n_data, false);
+    for(uint32_t data_idx = n_searched; data_idx < n_data; data_idx++){
+        is_changed[data_idx] = true;
+        changed_idxes.push_back(data_idx);
+    }
+    for(const std::vector<uint32_t> &changed : thread_changed){
+        for(const uint32_t data_idx : changed){
+            if(!is_changed[data_idx]){
+                is_changed[data_idx] = true;
+                changed_idxes.push_back(data_idx);
+            }
+        }
+    }
+
+    NeighborLists knn;
+    knn.offsets.resize(n_data + 1, 0);
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        knn.offsets[data_idx + 1] = knn.offsets[data_idx] + n_kept_[data_idx];
+        for(uint32_t k = 0; k < n_kept_[data_idx]; k++){
+            knn.dists.push_back(knn_lists_[data_idx][k].first);
+            knn.idxes.push_back(knn_lists_[data_idx][k].second);
+        }
+    }
+    RNN_ = ReverseNeighbors(knn, n_kept_, n_data);
+
+    return changed_idxes;
+}
+
+// Per label counts and distance sums of the rows in the n_levels-hop RNN neighborhood of every row of src_idxes,
+// searched like compute_inf_scores; the sums of the other rows are kept. The scores then follow from the sums for
+// any confusion matrix and class counts, so that the rows whose neighborhood did not change are not searched again.
+void Proposed::compute_rnn_label_sums(const std::vector<uint32_t> &src_idxes, const uint32_t n_levels)
+{
+    const uint32_t n_data = res_set_->size();
+    const uint32_t n_columns = n_classes_ + 1;
+    rnn_label_cnts_.resize((size_t)n_data * n_columns, 0);
+    rnn_label_dist_sums_.resize((size_t)n_data * n_columns, 0.f);
+    scored_level_ = n_levels;
+
+    const uint32_t n_threads = std::max(n_threads_, 1u);
+    std::vector<std::vector<uint32_t>> visit_stamps(n_threads, std::vector<uint32_t>(n_data, 0));
+    std::vector<std::vector<uint32_t>> instance_queues(n_threads);
+    ParallelFor(src_idxes.size(), n_threads, [&](const uint32_t s_idx, const uint32_t thread_idx){
+        std::vector<uint32_t> &visit_stamp = visit_stamps[thread_idx];
+        std::vector<uint32_t> &instance_queue = instance_queues[thread_idx];
+        const uint32_t src_idx = src_idxes[s_idx];
+        const uint32_t stamp = s_idx + 1;
+        uint32_t *label_cnts = &rnn_label_cnts_[(size_t)src_idx * n_columns];
+        float *label_dist_sums = &rnn_label_dist_sums_[(size_t)src_idx * n_columns];
+        std::fill(label_cnts, label_cnts + n_columns, 0);
+        std::fill(label_dist_sums, label_dist_sums + n_columns, 0.f);
+
+        instance_queue.clear();
+        instance_queue.emplace_back(src_idx);
+        visit_stamp[src_idx] = stamp;
+
+        uint32_t level_begin = 0;
+        for(uint32_t level = 0; level < n_levels; level++){
+            const uint32_t level_end = instance_queue.size();
+            for(uint32_t q_idx = level_begin; q_idx < level_end; q_idx++){
+                uint32_t data_idx = instance_queue[q_idx];
+                for(uint32_t idx = RNN_.offsets[data_idx]; idx < RNN_.offsets[data_idx + 1]; idx++){
+                    uint32_t rnn_idx = RNN_.idxes[idx];
+                    if(visit_stamp[rnn_idx] != stamp){
+                        if(level + 1 < n_levels){ // last level is not expanded
+                            instance_queue.emplace_back(rnn_idx);
+                        }
+                        visit_stamp[rnn_idx] = stamp;
+
+                        uint32_t rnn_label = (*res_set_)[rnn_idx][label_idx_];
+                        label_cnts[rnn_label]++;
+                        label_dist_sums[rnn_label] += (level == 0) ? RNN_.dists[idx] : get_distance(src_idx, rnn_idx);
+                    }
+                }
+            }
+            level_begin = level_end;
+        }
+    });
+}
+
+// Influence scores of every row from rnn_label_cnts_ and rnn_label_dist_sums_, into level_inf_scores_[n_levels].
+// The harmful labels are added after the search, so the negative sums may differ from compute_inf_scores in the last bits.
+void Proposed::compute_inf_scores_by_label(const std::vector<std::vector<uint32_t>> &confusion_matrix, const uint32_t n_levels)
+{
+    const uint32_t n_data = res_set_->size();
+    const uint32_t n_columns = n_classes_ + 1;
+    level_inf_scores_.assign(n_levels + 1, std::vector<float>());
+    std::vector<float> &inf_scores = level_inf_scores_[n_levels];
+    inf_scores.resize(n_data, 0.f);
+
+    for(uint32_t src_idx = 0; src_idx < n_data; src_idx++){
+        const uint32_t src_label = (*res_set_)[src_idx][label_idx_];
+        const uint32_t *label_cnts = &rnn_label_cnts_[(size_t)src_idx * n_columns];
+        const float *label_dist_sums = &rnn_label_dist_sums_[(size_t)src_idx * n_columns];
+
+        uint32_t n_neg_RNNs = 0;
+        float neg_dist_sum = 0.f;
+        for(uint32_t rnn_label = 1; rnn_label <= n_classes_; rnn_label++){
+            if(rnn_label != src_label && label_cnts[rnn_label] > 0 && is_harmful(src_label, rnn_label, confusion_matrix)){
+                n_neg_RNNs += label_cnts[rnn_label];
+                neg_dist_sum += label_dist_sums[rnn_label];
+            }
+        }
+        inf_scores[src_idx] = get_inf_score(src_label, label_cnts[src_label], n_neg_RNNs, label_dist_sums[src_label], neg_dist_sum);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <string>
+#include <vector>
+#include <memory> // std::unique_ptr
+#include "../../inc/resampler.h"
+#include "../../inc/decision_tree_classifier.h"
+
+// Names of all registered resamplers, i.e. the directories under comparing_algorithms/, with the multi-pass
+// variants after edited_nearest_neighbors, followed by proposed and its variants
+std::vector<std::string> GetResamplerNames(void);
+
+// Create a resampler with the parameters used by its own main.cpp; nullptr for an unknown name or search.
+// name may end with @auto, @brute, @kd_tree or @hnsw[<ef>] to choose how its neighbor queries are answered,
+// e.g. proposed@hnsw32. dtc_params must outlive the returned resampler.
+std::unique_ptr<Resampler> CreateResampler(const std::string &name, const decision_tree_parameter &dtc_params);
+
+#endif // REGISTRY_H
@@ -0,0 +1,106 @@
+#!/bin/bash
+
+declare -a synthetic_datasets=(
+    "spiral"
+    # "quantiles"
+    # "quantiles2"
+    # "quantiles4"
+    # "quantiles8"
+    # "quantiles16"
+    # "quantiles32"
+    # "example"
+)
+
+declare -a mul_real_world_datasets=(
+    "vowel"
+    # "segment"
+    # "optdigits"
+    # "penbased"
+    # "vehicle"
+    # "wine"
+    # "hayes-roth"
+    # "contraceptive"
+    # "satimage"
+    # "new-thyroid"
+    # "dermatology"
+    # "balance"
+    # "glass"
+    # "cleveland"
+    # "thyroid"
+    # "winequality-red"
+    # "ecoli"
+    # "yeast"
+    # "pageblocks"
+    # "winequality-white"
+    # "shuttle"
+)
+
+declare -a bin_real_world_datasets=(
+    "vowel0"
+    # "segment0"
+    # "vehicle0"
+    # "vehicle1"
+    # "vehicle2"
+    # "vehicle3"
+    # "new-thyroid1"
+    # "new-thyroid2"
+    # "dermatology-6"
+    # "glass0"
+    # "glass1"
+    # "glass2"
+    # "glass4"
+    # "glass5"
+    # "glass6"
+    # "winequality-red-4"
+    # "ecoli1"
+    # "ecoli2"
+    # "ecoli3"
+    # "ecoli4"
+    # "yeast1"
+    # "yeast3"
+    # "yeast4"
+    # "yeast5"
+    # "yeast6" 
+)
+
+# Algorithms to run, comma-separated directory names under ../comparing_algorithms/ and proposed, or "all"
+ALGORITHMS="all"
+
+# Number of runs for each dataset
+NUM_RUNS=20
+
+# Parameters for Decision Tree Classifier
+DTC_MIN_SAMPLES_SPLIT=10 
+DTC_MAX_PURITY=0.95
+
+# Parameters for the algorithms
+PROPOSED_LEVEL=2
+CC_TOLERANCE=0.0001
+CC_MAX_ITERS=100
+
+if [ ! -d "./build" ]; then
+    mkdir -p ./build
+fi
+cd build
+CMAKE_OPTIONS="
+    -DDTC_MIN_SAMPLES_SPLIT=${DTC_MIN_SAMPLES_SPLIT}
+    -DDTC_MAX_PURITY=${DTC_MAX_PURITY}
+    -DPROPOSED_LEVEL=${PROPOSED_LEVEL}
+    -DCC_TOLERANCE=${CC_TOLERANCE}
+    -DCC_MAX_ITERS=${CC_MAX_ITERS}
+"
+cmake $CMAKE_OPTIONS ..
+make
+
+if [ ! -d "../experiments" ]; then
+    mkdir -p ../experiments
+fi
+if [ ${#synthetic_datasets[@]} -gt 0 ]; then
+    ./runner ../experiments/exp_syn.csv 1 "$NUM_RUNS" "$ALGORITHMS" "${synthetic_datasets[@]}" # Synthetic datasets only have one fold.
+fi
+if [ ${#mul_real_world_datasets[@]} -gt 0 ]; then
+    ./runner ../experiments/exp_mul.csv 5 "$NUM_RUNS" "$ALGORITHMS" "${mul_real_world_datasets[@]}"
+fi
+if [ ${#bin_real_world_datasets[@]} -gt 0 ]; then
+    ./runner ../experiments/exp_bin.csv 5 "$NUM_RUNS" "$ALGORITHMS" "${bin_real_world_datasets[@]}"
+fi
@@ -0,0 +1,78 @@
+#include <cstdlib> // std::stoul
+#include <sstream> // std::stringstream
+#include "../../inc/experiment_driver.h" // LoadFolds
+#include "../../inc/nearest_neighbors.h" // FindKNearestNeighbors, ComputeRecall
+
+// Wall time of a call in milliseconds
+template<typename Function>
+static float MeasureMilliseconds(Function function)
+{
+    timespec start_ns = {0}, end_ns = {0};
+    clock_gettime(CLOCK_MONOTONIC, &start_ns);
+    function();
+    clock_gettime(CLOCK_MONOTONIC, &end_ns);
+    return (float)(end_ns.tv_sec - start_ns.tv_sec) * 1000 + (float)(end_ns.tv_nsec - start_ns.tv_nsec) / 1000000;
+}
+
+// Usage: ./knn_recall <output_file> <n_folds> <k> <ef[,ef...]> <dataset> [<dataset> ...]
+// Recall of NEIGHBOR_SEARCH_HNSW against the exact k nearest neighbors on the training set of every fold,
+// for every candidate list size ef, with the time of both searches averaged over the folds.
+int main(int argc, char *argv[])
+{
+    if(argc < 6){
+        printf("usage: %s <output_file> <n_folds> <k> <ef[,ef...]> <dataset> [<dataset> ...]\n", argv[0]);
+        exit(1);
+    }
+
+    const std::string output_path = argv[1];
+    const uint32_t n_folds = std::stoul(argv[2]);
+    const uint32_t k = std::stoul(argv[3]);
+
+    std::vector<uint32_t> efs;
+    std::stringstream ss(argv[4]);
+    std::string ef;
+    while(getline(ss, ef, ',')){
+        efs.push_back(std::stoul(ef));
+    }
+
+    std::ofstream file(output_path, std::ios::out);
+    if(!file.is_open()){
+        printf("./%s:%d: error: open file error\n", __FILE__, __LINE__);
+        exit(1);
+    }
+    file << "dataset,n_folds,k,ef,recall_mean,recall_min,exact_ms,hnsw_ms" << std::endl;
+
+    const uint32_t n_threads = GetNumThreads();
+    for(int arg_idx = 5; arg_idx < argc; arg_idx++){
+        const std::string dataset_name = argv[arg_idx];
+        const std::vector<Dataset> folds = LoadFolds("../../datasets", dataset_name, n_folds);
+
+        std::vector<NeighborLists> exact_neighbors(n_folds);
+        float exact_ms = 0.f;
+        for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+            const std::vector<uint32_t> ks(folds[fold_idx].training_set.size(), k);
+            exact_ms += MeasureMilliseconds([&](){
+                exact_neighbors[fold_idx] = FindKNearestNeighbors(folds[fold_idx].training_set, ks, n_threads);
+            });
+        }
+
+        for(uint32_t ef_idx = 0; ef_idx < efs.size(); ef_idx++){
+            float hnsw_ms = 0.f, recall_sum = 0.f, recall_min = 1.f;
+            for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+                const std::vector<uint32_t> ks(folds[fold_idx].training_set.size(), k);
+                NeighborLists hnsw_neighbors;
+                hnsw_ms += MeasureMilliseconds([&](){
+                    hnsw_neighbors = FindKNearestNeighbors(folds[fold_idx].training_set, ks, n_threads, nullptr,
+                                                            NEIGHBOR_SEARCH_HNSW, nullptr, efs[ef_idx]);
+                });
+
+                const float recall = ComputeRecall(hnsw_neighbors, exact_neighbors[fold_idx]);
+                recall_sum += recall;
+                recall_min = std::min(recall_min, recall);
+            }
+
+            file << dataset_name << "," << n_folds << "," << k << "," << efs[ef_idx] << std::fixed << std::setprecision(4)
+                    << "," << recall_sum / n_folds << "," << recall_min << "," << exact_ms / n_folds << "," << hnsw_ms / n_folds << std::endl;
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#include <cstdlib> // std::stoul
+#include <sstream> // std::stringstream
+#include "../../inc/experiment_driver.h" // LoadFolds, MapFoldRows, EvaluateFold, SummarizeMetrics, WriteExperimentSummaries
+#include "../../inc/distance_matrix.h"   // DistanceMatrix
+#include "../../inc/nearest_neighbors.h" // NeighborGraph
+#include "../inc/registry.h"             // GetResamplerNames, CreateResampler
+
+// Usage: ./runner <output_file> <n_folds> <n_runs> <algorithm[,algorithm...]|all> <dataset> [<dataset> ...]
+// Runs the algorithm x fold x run matrix of each dataset on all cores. The folds of a dataset are loaded once.
+// Their training sets are parts of one dataset, whose nearest neighbors (NeighborGraph) and, up to
+// EXPERIMENT_MATRIX_MAX_DATA rows, pairwise distances are computed once and shared by every neighbor-based algorithm,
+// fold and run; folds that are not leave the distances to the blocked neighbor searches of each resampler.
+// An algorithm may be listed with several neighbor searches (see CreateResampler), e.g. proposed,proposed@hnsw16,
+// to compare the metrics of approximate neighbors with the exact ones.
+int main(int argc, char *argv[])
+{
+    if(argc < 6){
+        printf("usage: %s <output_file> <n_folds> <n_runs> <algorithm[,algorithm...]|all> <dataset> [<dataset> ...]\n", argv[0]);
+        exit(1);
+    }
+
+    const std::string output_path = argv[1];
+    const uint32_t n_folds = std::stoul(argv[2]);
+    const uint32_t n_runs  = std::stoul(argv[3]);
+
+    std::vector<std::string> algorithm_names;
+    if((std::string)argv[4] == "all"){
+        algorithm_names = GetResamplerNames();
+    }
+    else{
+        std::stringstream ss(argv[4]);
+        std::string algorithm_name;
+        while(getline(ss, algorithm_name, ',')){
+            algorithm_names.push_back(algorithm_name);
+        }
+    }
+
+    const struct decision_tree_parameter dtc_params = {
+        .max_purity = DTC_MAX_PURITY,
+        .min_samples_split = DTC_MIN_SAMPLES_SPLIT
+    };
+
+    bool uses_distances = false;
+    for(uint32_t algorithm_idx = 0; algorithm_idx < algorithm_names.size(); algorithm_idx++){
+        std::unique_ptr<Resampler> resampler = CreateResampler(algorithm_names[algorithm_idx], dtc_params);
+        if(resampler == nullptr){
+            printf("./%s:%d: error: unknown algorithm %s\n", __FILE__, __LINE__, algorithm_names[algorithm_idx].c_str());
+            exit(1);
+        }
+        uses_distances |= resampler->uses_distances();
+    }
+
+    const uint32_t n_threads = GetNumThreads();
+    const uint32_t n_evaluations = n_runs * n_folds; // per algorithm
+    const uint32_t n_tasks = algorithm_names.size() * n_evaluations;
+
+    std::vector<ExperimentSummary> summaries;
+    for(int arg_idx = 5; arg_idx < argc; arg_idx++){
+        const std::string dataset_name = argv[arg_idx];
+        std::vector<Dataset> folds = LoadFolds("../../datasets", dataset_name, n_folds);
+
+        std::vector<std::vector<float>> full_set;
+        std::vector<std::vector<uint32_t>> fold_idxes; // row of full_set of every training row of every fold
+        std::unique_ptr<DistanceMatrix> full_dist_cache;
+        std::unique_ptr<NeighborGraph> neighbor_graph;
+        if(uses_distances && MapFoldRows(folds, full_set, fold_idxes)){
+            if(full_set.size() <= EXPERIMENT_MATRIX_MAX_DATA){
+                full_dist_cache = std::make_unique<DistanceMatrix>(full_set, n_threads);
+            }
+            neighbor_graph = std::make_unique<NeighborGraph>(full_set, GetNeighborGraphK(full_set.size()), n_threads);
+        }
+
+        std::vector<float> metrics(n_tasks * NUM_METRICS, 0.f); // one row per (algorithm, run, fold)
+        uint32_t n_classes = 0;
+        for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+            n_classes = std::max(n_classes, folds[fold_idx].n_classes);
+        }
+        // One accumulator per (algorithm, thread), merged per algorithm at the end
+        std::vector<MetricsAccumulator> accumulators(algorithm_names.size() * n_threads, MetricsAccumulator(n_classes));
+        ParallelFor(n_tasks, n_threads, [&](const uint32_t task_idx, const uint32_t thread_idx){
+            const uint32_t algorithm_idx = task_idx / n_evaluations;
+            const uint32_t fold_idx = (task_idx % n_evaluations) % n_folds;
+
+            std::unique_ptr<Resampler> resampler = CreateResampler(algorithm_names[algorithm_idx], dtc_params);
+            if(resampler->uses_distances() && neighbor_graph != nullptr){
+                resampler->set_distance_cache(full_dist_cache.get(), &fold_idxes[fold_idx], neighbor_graph.get());
+            }
+
+            ResampleFunction resample = [&resampler](const std::vector<std::vector<float>> &training_set, const uint32_t n_classes){
+                return resampler->fit_resample(training_set, n_classes);
+            };
+            EvaluateFold(folds[fold_idx], dtc_params, resample, &metrics[task_idx * NUM_METRICS], 
+                            &accumulators[algorithm_idx * n_threads + thread_idx]);
+        });
+
+        for(uint32_t algorithm_idx = 0; algorithm_idx < algorithm_names.size(); algorithm_idx++){
+            MetricsAccumulator &accumulator = accumulators[algorithm_idx * n_threads];
+            for(uint32_t thread_idx = 1; thread_idx < n_threads; thread_idx++){
+                accumulator.Merge(accumulators[algorithm_idx * n_threads + thread_idx]);
+            }
+            summaries.push_back(SummarizeMetrics(algorithm_names[algorithm_idx], dataset_name, 
+                                                    &metrics[algorithm_idx * n_evaluations * NUM_METRICS], n_evaluations, &accumulator, n_runs));
+        }
+        WriteExperimentSummaries(output_path, summaries); // keep the finished datasets if the campaign is interrupted
+    }
+}
@@ -0,0 +1,125 @@
+#include "../inc/registry.h"
+#include "../../comparing_algorithms/cluster_centroids/inc/cluster_centroids.h"
+#include "../../comparing_algorithms/edited_nearest_neighbors/inc/edited_nearest_neighbors.h"
+#include "../../comparing_algorithms/entropy_based_undersampling_approach/inc/entropy_based_undersampling_approach.h"
+#include "../../comparing_algorithms/instance_hardness_threshold/inc/instance_hardness_threshold.h"
+#include "../../comparing_algorithms/near_miss_2/inc/near_miss_2.h"
+#include "../../comparing_algorithms/random_under_sampling/inc/random_under_sampling.h"
+#include "../../proposed/inc/proposed.h"
+
+typedef std::unique_ptr<Resampler> (*ResamplerFactory)(const decision_tree_parameter &dtc_params);
+
+typedef struct ResamplerEntry{
+    const char *name;
+    ResamplerFactory create;
+}ResamplerEntry;
+
+static const ResamplerEntry RESAMPLER_REGISTRY[] = {
+    {"cluster_centroids", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        return std::make_unique<ClusterCentroids>(CC_MAX_ITERS, CC_TOLERANCE);
+    }},
+    {"edited_nearest_neighbors", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        return std::make_unique<EditedNearestNeighbors>(3); // k = 3
+    }},
+    {"repeated_edited_nearest_neighbors", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        std::unique_ptr<EditedNearestNeighbors> enn = std::make_unique<EditedNearestNeighbors>(3); // k = 3
+        enn->set_variant(ENN_REPEATED);
+        return enn;
+    }},
+    {"all_knn", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        std::unique_ptr<EditedNearestNeighbors> enn = std::make_unique<EditedNearestNeighbors>(3); // k = 1, 2, 3
+        enn->set_variant(ENN_ALL_KNN);
+        return enn;
+    }},
+    {"entropy_based_undersampling_approach", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        return std::make_unique<EntropyBasedUndersampling>(5); // k = 5
+    }},
+    {"instance_hardness_threshold", [](const decision_tree_parameter &dtc_params) -> std::unique_ptr<Resampler>{
+        return std::make_unique<InstanceHardnessThreshold>(dtc_params, 5); // 5-fold cross-validation
+    }},
+    {"near_miss_2", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        return std::make_unique<NearMiss2>(3); // k = 3
+    }},
+    {"random_under_sampling", [](const decision_tree_parameter &) -> std::unique_ptr<Resampler>{
+        return std::make_unique<RandomUnderSampler>();
+    }},
+    {"proposed", [](const decision_tree_parameter &dtc_params) -> std::unique_ptr<Resampler>{
+        return std::make_unique<Proposed>(dtc_params);
+    }},
+    {"proposed_ms_bfs", [](const decision_tree_parameter &dtc_params) -> std::unique_ptr<Resampler>{
+        std::unique_ptr<Proposed> proposed = std::make_unique<Proposed>(dtc_params);
+        proposed->set_inf_score_engine(INF_SCORE_MS_BFS);
+        return proposed;
+    }},
+    {"proposed_pv_subsample", [](const decision_tree_parameter &dtc_params) -> std::unique_ptr<Resampler>{
+        std::unique_ptr<Proposed> proposed = std::make_unique<Proposed>(dtc_params);
+        proposed->set_pre_validation(PRE_VALIDATION_SUBSAMPLE);
+        return proposed;
+    }},
+    {"proposed_pv_oob", [](const decision_tree_parameter &dtc_params) -> std::unique_ptr<Resampler>{
+        std::unique_ptr<Proposed> proposed = std::make_unique<Proposed>(dtc_params);
+        proposed->set_pre_validation(PRE_VALIDATION_OUT_OF_BAG);
+        return proposed;
+    }},
+};
+
+std::vector<std::string> GetResamplerNames(void)
+{
+    std::vector<std::string> names;
+    for(const ResamplerEntry &entry : RESAMPLER_REGISTRY){
+        names.emplace_back(entry.name);
+    }
+
+    return names;
+}
+
+// Parse the part of a resampler name after '@'; false for an unknown search
+static bool ParseNeighborSearch(const std::string &search_name, NeighborSearch &search, uint32_t &hnsw_ef)
+{
+    hnsw_ef = KNN_HNSW_EF;
+    if(search_name == "auto"){
+        search = NEIGHBOR_SEARCH_AUTO;
+    }
+    else if(search_name == "brute"){
+        search = NEIGHBOR_SEARCH_BRUTE;
+    }
+    else if(search_name == "kd_tree"){
+        search = NEIGHBOR_SEARCH_KD_TREE;
+    }
+    else if(search_name.compare(0, 4, "hnsw") == 0){
+        search = NEIGHBOR_SEARCH_HNSW;
+        if(search_name.size() > 4){
+            if(search_name.find_first_not_of("0123456789", 4) != std::string::npos){
+                return false;
+            }
+            hnsw_ef = std::stoul(search_name.substr(4));
+        }
+    }
+    else{
+        return false;
+    }
+
+    return hnsw_ef > 0;
+}
+
+std::unique_ptr<Resampler> CreateResampler(const std::string &name, const decision_tree_parameter &dtc_params)
+{
+    const size_t separator = name.find('@');
+    const std::string resampler_name = name.substr(0, separator);
+
+    NeighborSearch search = NEIGHBOR_SEARCH_AUTO;
+    uint32_t hnsw_ef = KNN_HNSW_EF;
+    if(separator != std::string::npos && !ParseNeighborSearch(name.substr(separator + 1), search, hnsw_ef)){
+        return nullptr;
+    }
+
+    for(const ResamplerEntry &entry : RESAMPLER_REGISTRY){
+        if(resampler_name == entry.name){
+            std::unique_ptr<Resampler> resampler = entry.create(dtc_params);
+            resampler->set_neighbor_search(search, hnsw_ef);
+            return resampler;
+        }
+    }
+
+    return nullptr;
+}
@@ -114,6 +114,8 @@ void DecisionTreeClassifier::FindBestSplitPoint(std::shared_ptr<TreeNode> node,
         for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
             node->predict_prob[class_idx] = static_cast<float>(partition_class_counts[class_idx]) / partition_size;
         }
+        node->leaf_idx = leaves.size();
+        leaves.push_back(node.get());
         return;
     } 
 
@@ -166,6 +168,8 @@ void DecisionTreeClassifier::FindBestSplitPoint(std::shared_ptr<TreeNode> node,
         for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
             node->predict_prob[class_idx] = static_cast<float>(partition_class_counts[class_idx]) / partition_size;
         }
+        node->leaf_idx = leaves.size();
+        leaves.push_back(node.get());
     }
 }
 
@@ -210,23 +214,39 @@ DecisionTreeClassifier::DecisionTreeClassifier(const std::vector<std::vector<flo
     }
 }
 
-std::vector<float> DecisionTreeClassifier::GetPredictProb(const std::vector<float> &testing_sample)
+const DecisionTreeClassifier::TreeNode *DecisionTreeClassifier::FindLeaf(const std::vector<float> &testing_sample) const
 {
-    std::shared_ptr<TreeNode> current_node = root;
+    // Walk raw pointers to avoid the reference counting of copying shared_ptr at every level.
+    const TreeNode *current_node = root.get();
     while(current_node->left_child != NULL && current_node->right_child != NULL){
         if(testing_sample[current_node->split_point.feature] <= current_node->split_point.value){
-            current_node = current_node->left_child;
+            current_node = current_node->left_child.get();
         }
         else{
-            current_node = current_node->right_child;
+            current_node = current_node->right_child.get();
         }
     }
-    return current_node->predict_prob;
+    return current_node;
+}
+
+const std::vector<float> &DecisionTreeClassifier::GetLeafPredictProb(const std::vector<float> &testing_sample) const
+{
+    return FindLeaf(testing_sample)->predict_prob;
+}
+
+uint32_t DecisionTreeClassifier::GetLeafIdx(const std::vector<float> &testing_sample) const
+{
+    return FindLeaf(testing_sample)->leaf_idx;
+}
+
+std::vector<float> DecisionTreeClassifier::GetPredictProb(const std::vector<float> &testing_sample)
+{
+    return GetLeafPredictProb(testing_sample);
 }
 
 uint32_t DecisionTreeClassifier::GetPredictLabel(const std::vector<float> &testing_sample)
 {
-    std::vector<float> predict_prob = GetPredictProb(testing_sample);
+    const std::vector<float> &predict_prob = GetLeafPredictProb(testing_sample);
     return std::distance(predict_prob.begin(), std::max_element(predict_prob.begin() + 1, predict_prob.end()));
 }
 
@@ -0,0 +1,200 @@
+#include "../inc/distance_kernel.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// One query against whole panels, accumulating every lane feature by feature like SquareDistance
+static void ExactKernelScalar(const float *query, const float *panels, const uint32_t n_panels, const uint32_t n_features,
+                                float *square_dists)
+{
+    for(uint32_t panel_idx = 0; panel_idx < n_panels; panel_idx++){
+        const float *panel = panels + panel_idx * n_features * DISTANCE_PANEL_WIDTH;
+        float *dists = square_dists + panel_idx * DISTANCE_PANEL_WIDTH;
+        std::fill(dists, dists + DISTANCE_PANEL_WIDTH, 0.f);
+        for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+            for(uint32_t lane = 0; lane < DISTANCE_PANEL_WIDTH; lane++){
+                float diff = query[feature_idx] - panel[feature_idx * DISTANCE_PANEL_WIDTH + lane];
+                dists[lane] += diff * diff;
+            }
+        }
+    }
+}
+
+// Up to DISTANCE_QUERY_TILE queries against whole panels; missing queries repeat the first one and are not stored
+static void ApproxKernelScalar(const float *queries[DISTANCE_QUERY_TILE], const float *query_norms, const uint32_t n_queries,
+                                const float *panels, const float *square_norms, const uint32_t n_panels,
+                                const uint32_t n_features, float *block, const uint32_t stride)
+{
+    for(uint32_t panel_idx = 0; panel_idx < n_panels; panel_idx++){
+        const float *panel = panels + panel_idx * n_features * DISTANCE_PANEL_WIDTH;
+        for(uint32_t query_idx = 0; query_idx < n_queries; query_idx++){
+            float dots[DISTANCE_PANEL_WIDTH] = {0};
+            for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+                for(uint32_t lane = 0; lane < DISTANCE_PANEL_WIDTH; lane++){
+                    dots[lane] += queries[query_idx][feature_idx] * panel[feature_idx * DISTANCE_PANEL_WIDTH + lane];
+                }
+            }
+
+            float *row = block + query_idx * stride + panel_idx * DISTANCE_PANEL_WIDTH;
+            for(uint32_t lane = 0; lane < DISTANCE_PANEL_WIDTH; lane++){
+                row[lane] = query_norms[query_idx] + square_norms[panel_idx * DISTANCE_PANEL_WIDTH + lane] - 2 * dots[lane];
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Without fma in the target, the compiler cannot fuse the product into the sum, so lanes round like SquareDistance
+__attribute__((target("avx2")))
+static void ExactKernelAVX2(const float *query, const float *panels, const uint32_t n_panels, const uint32_t n_features,
+                                float *square_dists)
+{
+    for(uint32_t panel_idx = 0; panel_idx < n_panels; panel_idx++){
+        const float *panel = panels + panel_idx * n_features * DISTANCE_PANEL_WIDTH;
+        __m256 low = _mm256_setzero_ps(), high = _mm256_setzero_ps();
+        for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+            const __m256 value = _mm256_set1_ps(query[feature_idx]);
+            const __m256 low_diff  = _mm256_sub_ps(value, _mm256_loadu_ps(panel + feature_idx * DISTANCE_PANEL_WIDTH));
+            const __m256 high_diff = _mm256_sub_ps(value, _mm256_loadu_ps(panel + feature_idx * DISTANCE_PANEL_WIDTH + 8));
+            low  = _mm256_add_ps(low,  _mm256_mul_ps(low_diff,  low_diff));
+            high = _mm256_add_ps(high, _mm256_mul_ps(high_diff, high_diff));
+        }
+        _mm256_storeu_ps(square_dists + panel_idx * DISTANCE_PANEL_WIDTH, low);
+        _mm256_storeu_ps(square_dists + panel_idx * DISTANCE_PANEL_WIDTH + 8, high);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void ApproxKernelAVX2(const float *queries[DISTANCE_QUERY_TILE], const float *query_norms, const uint32_t n_queries,
+                                const float *panels, const float *square_norms, const uint32_t n_panels,
+                                const uint32_t n_features, float *block, const uint32_t stride)
+{
+    for(uint32_t panel_idx = 0; panel_idx < n_panels; panel_idx++){
+        const float *panel = panels + panel_idx * n_features * DISTANCE_PANEL_WIDTH;
+        __m256 dots[DISTANCE_QUERY_TILE][2];
+        for(uint32_t query_idx = 0; query_idx < DISTANCE_QUERY_TILE; query_idx++){
+            dots[query_idx][0] = dots[query_idx][1] = _mm256_setzero_ps();
+        }
+        for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+            const __m256 low  = _mm256_loadu_ps(panel + feature_idx * DISTANCE_PANEL_WIDTH);
+            const __m256 high = _mm256_loadu_ps(panel + feature_idx * DISTANCE_PANEL_WIDTH + 8);
+            for(uint32_t query_idx = 0; query_idx < DISTANCE_QUERY_TILE; query_idx++){
+                const __m256 value = _mm256_set1_ps(queries[query_idx][feature_idx]);
+                dots[query_idx][0] = _mm256_fmadd_ps(value, low,  dots[query_idx][0]);
+                dots[query_idx][1] = _mm256_fmadd_ps(value, high, dots[query_idx][1]);
+            }
+        }
+
+        const __m256 minus_two = _mm256_set1_ps(-2.f);
+        const __m256 low_norms  = _mm256_loadu_ps(square_norms + panel_idx * DISTANCE_PANEL_WIDTH);
+        const __m256 high_norms = _mm256_loadu_ps(square_norms + panel_idx * DISTANCE_PANEL_WIDTH + 8);
+        for(uint32_t query_idx = 0; query_idx < n_queries; query_idx++){
+            const __m256 query_norm = _mm256_set1_ps(query_norms[query_idx]);
+            float *row = block + query_idx * stride + panel_idx * DISTANCE_PANEL_WIDTH;
+            _mm256_storeu_ps(row,     _mm256_fmadd_ps(minus_two, dots[query_idx][0], _mm256_add_ps(query_norm, low_norms)));
+            _mm256_storeu_ps(row + 8, _mm256_fmadd_ps(minus_two, dots[query_idx][1], _mm256_add_ps(query_norm, high_norms)));
+        }
+    }
+}
+
+// avx512f implies fma, so contraction is turned off to keep the product out of the sum and round lanes like SquareDistance
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+static void ExactKernelAVX512(const float *query, const float *panels, const uint32_t n_panels, const uint32_t n_features,
+                                float *square_dists)
+{
+    for(uint32_t panel_idx = 0; panel_idx < n_panels; panel_idx++){
+        const float *panel = panels + panel_idx * n_features * DISTANCE_PANEL_WIDTH;
+        __m512 sum = _mm512_setzero_ps();
+        for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+            const __m512 diff = _mm512_sub_ps(_mm512_set1_ps(query[feature_idx]), _mm512_loadu_ps(panel + feature_idx * DISTANCE_PANEL_WIDTH));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(diff, diff));
+        }
+        _mm512_storeu_ps(square_dists + panel_idx * DISTANCE_PANEL_WIDTH, sum);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void ApproxKernelAVX512(const float *queries[DISTANCE_QUERY_TILE], const float *query_norms, const uint32_t n_queries,
+                                const float *panels, const float *square_norms, const uint32_t n_panels,
+                                const uint32_t n_features, float *block, const uint32_t stride)
+{
+    for(uint32_t panel_idx = 0; panel_idx < n_panels; panel_idx++){
+        const float *panel = panels + panel_idx * n_features * DISTANCE_PANEL_WIDTH;
+        __m512 dots[DISTANCE_QUERY_TILE];
+        for(uint32_t query_idx = 0; query_idx < DISTANCE_QUERY_TILE; query_idx++){
+            dots[query_idx] = _mm512_setzero_ps();
+        }
+        for(uint32_t feature_idx = 0; feature_idx < n_features; feature_idx++){
+            const __m512 column = _mm512_loadu_ps(panel + feature_idx * DISTANCE_PANEL_WIDTH);
+            for(uint32_t query_idx = 0; query_idx < DISTANCE_QUERY_TILE; query_idx++){
+                dots[query_idx] = _mm512_fmadd_ps(_mm512_set1_ps(queries[query_idx][feature_idx]), column, dots[query_idx]);
+            }
+        }
+
+        const __m512 minus_two = _mm512_set1_ps(-2.f);
+        const __m512 norms = _mm512_loadu_ps(square_norms + panel_idx * DISTANCE_PANEL_WIDTH);
+        for(uint32_t query_idx = 0; query_idx < n_queries; query_idx++){
+            _mm512_storeu_ps(block + query_idx * stride + panel_idx * DISTANCE_PANEL_WIDTH,
+                                _mm512_fmadd_ps(minus_two, dots[query_idx], _mm512_add_ps(_mm512_set1_ps(query_norms[query_idx]), norms)));
+        }
+    }
+}
+#endif
+
+DistancePanels::DistancePanels(const std::vector<std::vector<float>> &dataset)
+                    :n_data_(dataset.size()), exact_kernel_(ExactKernelScalar), approx_kernel_(ApproxKernelScalar)
+{
+    n_features_ = dataset.empty() ? 0 : dataset[0].size() - 1; // the last column of vector stores the label
+    // first-order bound on the rounding of SquareDistance and of the norms and dot product of the identity
+    error_scale_ = (2 * n_features_ + 4) * FLT_EPSILON;
+
+    const uint32_t n_panels = (n_data_ + DISTANCE_PANEL_WIDTH - 1) / DISTANCE_PANEL_WIDTH;
+    panels_.resize(n_panels * n_features_ * DISTANCE_PANEL_WIDTH, 0.f);
+    rows_.resize(n_data_ * n_features_);
+    square_norms_.resize(n_panels * DISTANCE_PANEL_WIDTH, 0.f);
+    for(uint32_t data_idx = 0; data_idx < n_data_; data_idx++){
+        float *panel = &panels_[data_idx / DISTANCE_PANEL_WIDTH * n_features_ * DISTANCE_PANEL_WIDTH];
+        for(uint32_t feature_idx = 0; feature_idx < n_features_; feature_idx++){
+            panel[feature_idx * DISTANCE_PANEL_WIDTH + data_idx % DISTANCE_PANEL_WIDTH] = dataset[data_idx][feature_idx];
+            square_norms_[data_idx] += dataset[data_idx][feature_idx] * dataset[data_idx][feature_idx];
+        }
+        std::copy(dataset[data_idx].begin(), dataset[data_idx].begin() + n_features_, rows_.begin() + data_idx * n_features_);
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        exact_kernel_  = ExactKernelAVX512;
+        approx_kernel_ = ApproxKernelAVX512;
+    }
+    else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        exact_kernel_  = ExactKernelAVX2;
+        approx_kernel_ = ApproxKernelAVX2;
+    }
+#endif
+}
+
+void DistancePanels::ComputeSquareDistances(const float *query, const uint32_t data_begin, const uint32_t data_end, float *square_dists) const
+{
+    const uint32_t n_panels = GetBlockStride(data_begin, data_end) / DISTANCE_PANEL_WIDTH;
+    exact_kernel_(query, panels_.data() + data_begin * n_features_, n_panels, n_features_, square_dists);
+}
+
+void DistancePanels::ComputeApproxSquareDistances(const uint32_t query_begin, const uint32_t query_end, const uint32_t data_begin,
+                                                    const uint32_t data_end, float *block) const
+{
+    const uint32_t stride = GetBlockStride(data_begin, data_end);
+    for(uint32_t tile_begin = query_begin; tile_begin < query_end; tile_begin += DISTANCE_QUERY_TILE){
+        const uint32_t n_queries = std::min(query_end - tile_begin, (uint32_t)DISTANCE_QUERY_TILE);
+        const float *queries[DISTANCE_QUERY_TILE];
+        float query_norms[DISTANCE_QUERY_TILE];
+        for(uint32_t query_idx = 0; query_idx < DISTANCE_QUERY_TILE; query_idx++){
+            const uint32_t row_idx = tile_begin + ((query_idx < n_queries) ? query_idx : 0);
+            queries[query_idx]     = rows_.data() + row_idx * n_features_;
+            query_norms[query_idx] = square_norms_[row_idx];
+        }
+
+        approx_kernel_(queries, query_norms, n_queries, panels_.data() + data_begin * n_features_, square_norms_.data() + data_begin,
+                        stride / DISTANCE_PANEL_WIDTH, n_features_, block + (tile_begin - query_begin) * stride, stride);
+    }
+}
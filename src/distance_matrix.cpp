@@ -0,0 +1,25 @@
+#include "../inc/distance_matrix.h"
+
+DistanceMatrix::DistanceMatrix(const std::vector<std::vector<float>> &dataset, const uint32_t n_threads)
+                    :n_data_(dataset.size())
+{
+    // Row src_idx stores (n_data_ - src_idx - 1) distances, shifted so that it can be indexed by dst_idx directly
+    row_offsets_.resize(n_data_, 0);
+    uint64_t n_dists = 0;
+    for(uint32_t src_idx = 0; src_idx < n_data_; src_idx++){
+        row_offsets_[src_idx] = n_dists - (src_idx + 1);
+        n_dists += n_data_ - src_idx - 1;
+    }
+    dists_.resize(n_dists);
+
+    const DistancePanels panels(dataset);
+    std::vector<std::vector<float>> square_dists(std::max(n_threads, 1u), std::vector<float>(DistancePanels::GetBlockStride(0, n_data_)));
+    ParallelFor(n_data_, n_threads, [&](const uint32_t src_idx, const uint32_t thread_idx){
+        // from the panel holding src_idx + 1, so that the rows before it are not computed
+        const uint32_t data_begin = (src_idx + 1) / DISTANCE_PANEL_WIDTH * DISTANCE_PANEL_WIDTH;
+        panels.ComputeSquareDistances(dataset[src_idx].data(), data_begin, n_data_, square_dists[thread_idx].data());
+        for(uint32_t dst_idx = src_idx + 1; dst_idx < n_data_; dst_idx++){
+            dists_[row_offsets_[src_idx] + dst_idx] = sqrt(square_dists[thread_idx][dst_idx - data_begin]);
+        }
+    });
+}
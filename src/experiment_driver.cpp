@@ -0,0 +1,219 @@
+#include "../inc/experiment_driver.h"
+
+void EvaluateFold(const Dataset &fold, const decision_tree_parameter dtc_params, const ResampleFunction &resample, float *metrics,
+                    MetricsAccumulator *accumulator)
+{
+    timespec start_ns = {0}, end_ns = {0};
+    clock_gettime(EXPERIMENT_CLOCK, &start_ns);
+    std::vector<std::vector<float>> resampled_set = resample(fold.training_set, fold.n_classes);
+    clock_gettime(EXPERIMENT_CLOCK, &end_ns);
+    float running_time_ms = (float)(end_ns.tv_sec - start_ns.tv_sec) * 1000 + 
+                                (float)(end_ns.tv_nsec - start_ns.tv_nsec) / 1000000;
+
+    EvaluateResampledSet(fold, resampled_set, dtc_params, metrics, accumulator);
+    metrics[8] += running_time_ms;
+}
+
+void EvaluateResampledSet(const Dataset &fold, const std::vector<std::vector<float>> &resampled_set, const decision_tree_parameter dtc_params, 
+                            float *metrics, MetricsAccumulator *accumulator)
+{
+    float running_time_ms = 0.f;
+    timespec start_ns = {0}, end_ns = {0};
+    clock_gettime(EXPERIMENT_CLOCK, &start_ns);
+    Validation k_fold_validation(resampled_set, fold.testing_set, fold.n_classes, dtc_params, false);
+    clock_gettime(EXPERIMENT_CLOCK, &end_ns);
+    running_time_ms = (float)(end_ns.tv_sec - start_ns.tv_sec) * 1000 + 
+                                (float)(end_ns.tv_nsec - start_ns.tv_nsec) / 1000000;
+
+    metrics[0] = k_fold_validation.macro_precision;
+    metrics[1] = k_fold_validation.macro_recall;
+    metrics[2] = k_fold_validation.macro_f1;
+    metrics[3] = k_fold_validation.g_mean;
+    metrics[4] = k_fold_validation.MACC;
+    metrics[5] = k_fold_validation.MAUC;
+    metrics[6] = k_fold_validation.MMCC;
+    metrics[7] = k_fold_validation.Cohens_Kappa;
+    metrics[8] = running_time_ms;
+
+    if(accumulator != nullptr){
+        accumulator->Merge(k_fold_validation.accumulator);
+    }
+}
+
+std::vector<Dataset> LoadFolds(const std::string datasets_dir, const std::string dataset_name, const uint32_t n_folds)
+{
+    std::vector<Dataset> folds(n_folds);
+    std::string file_path = datasets_dir + "/" + dataset_name + "-5-fold/" + dataset_name + "-5-";
+    for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+        std::string training_path = file_path + std::to_string(fold_idx + 1) + "tra.dat";
+        std::string testing_path  = file_path + std::to_string(fold_idx + 1) + "tst.dat";
+        folds[fold_idx] = ReadTrainingAndTestingSet(training_path, testing_path);
+    }
+
+    return folds;
+}
+
+bool MapFoldRows(const std::vector<Dataset> &folds, std::vector<std::vector<float>> &dataset, 
+                    std::vector<std::vector<uint32_t>> &fold_idxes)
+{
+    dataset.clear();
+    fold_idxes.clear();
+    if(folds.empty()){
+        return false;
+    }
+    dataset = folds[0].training_set;
+    dataset.insert(dataset.end(), folds[0].testing_set.begin(), folds[0].testing_set.end());
+
+    std::vector<uint32_t> sorted_idxes(dataset.size());
+    for(uint32_t data_idx = 0; data_idx < dataset.size(); data_idx++){
+        sorted_idxes[data_idx] = data_idx;
+    }
+    auto row_less = [&dataset](const uint32_t a, const uint32_t b){return dataset[a] < dataset[b];};
+    std::sort(sorted_idxes.begin(), sorted_idxes.end(), row_less);
+
+    fold_idxes.resize(folds.size());
+    std::vector<bool> is_matched(dataset.size());
+    for(uint32_t fold_idx = 0; fold_idx < folds.size(); fold_idx++){
+        const std::vector<std::vector<float>> &training_set = folds[fold_idx].training_set;
+        is_matched.assign(dataset.size(), false);
+        fold_idxes[fold_idx].resize(training_set.size());
+        for(uint32_t data_idx = 0; data_idx < training_set.size(); data_idx++){
+            const std::vector<float> &row = training_set[data_idx];
+            auto first = std::lower_bound(sorted_idxes.begin(), sorted_idxes.end(), row, 
+                                            [&dataset](const uint32_t idx, const std::vector<float> &row){return dataset[idx] < row;});
+            auto last  = std::upper_bound(first, sorted_idxes.end(), row, 
+                                            [&dataset](const std::vector<float> &row, const uint32_t idx){return row < dataset[idx];});
+            auto match = std::find_if(first, last, [&is_matched](const uint32_t idx){return !is_matched[idx];});
+            if(match == last){
+                dataset.clear();
+                fold_idxes.clear();
+                return false;
+            }
+            is_matched[*match] = true;
+            fold_idxes[fold_idx][data_idx] = *match;
+        }
+    }
+
+    return true;
+}
+
+ExperimentSummary SummarizeMetrics(const std::string algorithm_name, const std::string dataset_name, 
+                                        const float *metrics, const uint32_t n_evaluations,
+                                            const MetricsAccumulator *accumulator, const uint32_t n_runs,
+                                                const uint64_t bootstrap_seed)
+{
+    ExperimentSummary summary;
+    summary.algorithm_name = algorithm_name;
+    summary.dataset_name   = dataset_name;
+    summary.n_evaluations  = n_evaluations;
+    summary.bootstrap_seed = bootstrap_seed;
+    summary.means.resize(NUM_METRICS, 0.f);
+    summary.stds.resize(NUM_METRICS, 0.f);
+    for(uint32_t metric_idx = 0; metric_idx < NUM_METRICS; metric_idx++){
+        double sum = 0., square_sum = 0.;
+        for(uint32_t eval_idx = 0; eval_idx < n_evaluations; eval_idx++){
+            double value = metrics[eval_idx * NUM_METRICS + metric_idx];
+            sum        += value;
+            square_sum += value * value;
+        }
+
+        double mean = sum / n_evaluations;
+        summary.means[metric_idx] = mean;
+        if(n_evaluations > 1){
+            double variance = (square_sum - n_evaluations * mean * mean) / (n_evaluations - 1);
+            summary.stds[metric_idx] = sqrt(variance > 0. ? variance : 0.);
+        }
+    }
+
+    if(accumulator != nullptr){
+        Metrics pooled = accumulator->ComputeMetrics();
+        summary.pooled = {pooled.macro_precision, pooled.macro_recall, pooled.macro_f1, pooled.g_mean, 
+                            pooled.MACC, pooled.MAUC, pooled.MMCC, pooled.Cohens_Kappa};
+
+        MetricsInterval interval = accumulator->ComputeBootstrapIntervals(BOOTSTRAP_RESAMPLES, BOOTSTRAP_CONFIDENCE_LEVEL, 
+                                                                            accumulator->GetNumData() / n_runs, 
+                                                                                bootstrap_seed, false, GetNumThreads());
+        summary.pooled_lower = {interval.lower.macro_precision, interval.lower.macro_recall, interval.lower.macro_f1, interval.lower.g_mean, 
+                                    interval.lower.MACC, interval.lower.MAUC, interval.lower.MMCC, interval.lower.Cohens_Kappa};
+        summary.pooled_upper = {interval.upper.macro_precision, interval.upper.macro_recall, interval.upper.macro_f1, interval.upper.g_mean, 
+                                    interval.upper.MACC, interval.upper.MAUC, interval.upper.MMCC, interval.upper.Cohens_Kappa};
+    }
+
+    return summary;
+}
+
+ExperimentSummary RunRepeatedCrossValidation(const std::string datasets_dir, const std::string dataset_name, 
+                                                const uint32_t n_folds, const uint32_t n_runs, 
+                                                    const decision_tree_parameter dtc_params,
+                                                        const ResampleFunction &resample, const uint32_t n_threads)
+{
+    // Each fold is parsed and normalized once and shared read-only by all runs
+    std::vector<Dataset> folds = LoadFolds(datasets_dir, dataset_name, n_folds);
+
+    const uint32_t n_evaluations = n_runs * n_folds;
+    std::vector<float> metrics(n_evaluations * NUM_METRICS, 0.f); // one row per (run, fold)
+    uint32_t n_classes = 0;
+    for(uint32_t fold_idx = 0; fold_idx < n_folds; fold_idx++){
+        n_classes = std::max(n_classes, folds[fold_idx].n_classes);
+    }
+    std::vector<MetricsAccumulator> accumulators(n_threads, MetricsAccumulator(n_classes)); // one per thread, merged at the end
+    ParallelFor(n_evaluations, n_threads, [&](const uint32_t eval_idx, const uint32_t thread_idx){
+        EvaluateFold(folds[eval_idx % n_folds], dtc_params, resample, &metrics[eval_idx * NUM_METRICS], &accumulators[thread_idx]);
+    });
+    for(uint32_t thread_idx = 1; thread_idx < n_threads; thread_idx++){
+        accumulators[0].Merge(accumulators[thread_idx]);
+    }
+
+    return SummarizeMetrics("", dataset_name, metrics.data(), n_evaluations, &accumulators[0], n_runs);
+}
+
+void WriteExperimentSummaries(const std::string output_path, const std::vector<ExperimentSummary> &summaries)
+{
+    std::ofstream file(output_path, std::ios::out);
+    if(!file.is_open()){
+        printf("./%s:%d: error: open file error\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    file << "algorithm,dataset,n_evaluations";
+    for(uint32_t metric_idx = 0; metric_idx < NUM_METRICS; metric_idx++){
+        file << "," << METRIC_NAMES[metric_idx] << "_mean," << METRIC_NAMES[metric_idx] << "_std";
+    }
+    for(uint32_t metric_idx = 0; metric_idx < NUM_POOLED_METRICS; metric_idx++){
+        file << "," << METRIC_NAMES[metric_idx] << "_pooled";
+    }
+    for(uint32_t metric_idx = 0; metric_idx < NUM_POOLED_METRICS; metric_idx++){
+        file << "," << METRIC_NAMES[metric_idx] << "_pooled_lower," << METRIC_NAMES[metric_idx] << "_pooled_upper";
+    }
+    file << ",bootstrap_seed" << std::endl;
+
+    for(uint32_t summary_idx = 0; summary_idx < summaries.size(); summary_idx++){
+        const ExperimentSummary &summary = summaries[summary_idx];
+        file << summary.algorithm_name << "," << summary.dataset_name << "," << summary.n_evaluations;
+        for(uint32_t metric_idx = 0; metric_idx < NUM_METRICS; metric_idx++){
+            file << std::fixed << std::setprecision(4) << "," << summary.means[metric_idx] << "," << summary.stds[metric_idx];
+        }
+        for(uint32_t metric_idx = 0; metric_idx < NUM_POOLED_METRICS; metric_idx++){
+            file << ",";
+            if(metric_idx < summary.pooled.size()){
+                file << std::fixed << std::setprecision(4) << summary.pooled[metric_idx];
+            }
+        }
+        for(uint32_t metric_idx = 0; metric_idx < NUM_POOLED_METRICS; metric_idx++){
+            file << ",";
+            if(metric_idx < summary.pooled_lower.size()){
+                file << std::fixed << std::setprecision(4) << summary.pooled_lower[metric_idx];
+            }
+            file << ",";
+            if(metric_idx < summary.pooled_upper.size()){
+                file << std::fixed << std::setprecision(4) << summary.pooled_upper[metric_idx];
+            }
+        }
+        file << ",";
+        if(!summary.pooled_lower.empty()){
+            file << summary.bootstrap_seed;
+        }
+        file << std::endl;
+    }
+    file.close();
+}
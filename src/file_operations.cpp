@@ -1,5 +1,26 @@
 #include "../inc/file_operations.h"
 
+#include <deque>              // std::deque
+#include <mutex>              // std::mutex
+#include <thread>             // std::thread
+#include <condition_variable> // std::condition_variable
+
+#ifdef HAVE_ZLIB
+    #include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+    #include <zstd.h>
+#endif
+
+#define DECOMPRESSION_CHUNK_SIZE (1 << 17) // 128 KiB per decompressed chunk
+#define DECOMPRESSION_QUEUE_SIZE 8         // chunks buffered ahead of the parser
+
+typedef enum CompressionFormat{
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+}CompressionFormat;
+
 static bool IsLabelExist(const std::vector<uint32_t> &labels, const uint32_t label)
 {
     for(uint32_t label_idx = 0; label_idx < labels.size(); label_idx++){
@@ -25,15 +46,184 @@ static void GetNumClasses(Dataset &dataset)
     dataset.n_classes = labels.size();
 }
 
-static void ReadDataset(std::vector<std::vector<float>> &dataset, const std::string file_path)
+static bool IsFileExist(const std::string &file_path)
 {
-    std::ifstream file;
-    file.open(file_path, std::ios::in);
-    if (!file.is_open()){
-        printf("./%s:%d: error: open file error\n", __FILE__, __LINE__);
-        exit(1);
+    std::ifstream file(file_path, std::ios::in | std::ios::binary);
+    return file.is_open();
+}
+
+static CompressionFormat DetectCompressionFormat(const std::string &file_path)
+{
+    // Detect by magic number so that the file extension does not matter
+    unsigned char magic[4] = {0, 0, 0, 0};
+    std::ifstream file(file_path, std::ios::in | std::ios::binary);
+    file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+
+    if(file.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b){
+        return COMPRESSION_GZIP;
+    }
+    if(file.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd){
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+// Bounded queue of decompressed chunks shared by the decompression thread (producer) and the parser (consumer)
+class ChunkQueue{
+    public:
+        ChunkQueue(const uint32_t max_chunks) :max_chunks_(max_chunks)
+        {
+            is_finished_ = false;
+            is_failed_   = false;
+        };
+
+        void Push(std::string &chunk)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this](){return chunks_.size() < max_chunks_;});
+            chunks_.emplace_back(std::move(chunk));
+            not_empty_.notify_one();
+        }
+
+        // Return false when the producer has finished and every chunk is consumed
+        bool Pop(std::string &chunk)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this](){return !chunks_.empty() || is_finished_;});
+            if(chunks_.empty()){
+                return false;
+            }
+            chunk = std::move(chunks_.front());
+            chunks_.pop_front();
+            not_full_.notify_one();
+            return true;
+        }
+
+        void Finish(const bool is_failed)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_finished_ = true;
+            is_failed_   = is_failed;
+            not_empty_.notify_all();
+        }
+
+        bool IsFailed(void)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return is_failed_;
+        }
+
+    private:
+        const uint32_t max_chunks_;
+        bool is_finished_;
+        bool is_failed_;
+        std::deque<std::string> chunks_;
+        std::mutex mutex_;
+        std::condition_variable not_full_;
+        std::condition_variable not_empty_;
+};
+
+// Expose the chunk queue as a std::streambuf so the text parser stays the same for every input format
+class ChunkStreamBuf : public std::streambuf{
+    public:
+        ChunkStreamBuf(ChunkQueue &queue) :queue_(queue){};
+
+    protected:
+        int_type underflow() override
+        {
+            while(gptr() == egptr()){
+                if(!queue_.Pop(chunk_)){
+                    return traits_type::eof();
+                }
+                setg(&chunk_[0], &chunk_[0], &chunk_[0] + chunk_.size());
+            }
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        ChunkQueue &queue_;
+        std::string chunk_;
+};
+
+static void InflateGzip([[maybe_unused]] const std::string file_path, ChunkQueue &queue)
+{
+#ifdef HAVE_ZLIB
+    gzFile file = gzopen(file_path.c_str(), "rb");
+    if(file == NULL){
+        queue.Finish(true);
+        return;
     }
+    gzbuffer(file, DECOMPRESSION_CHUNK_SIZE);
 
+    bool is_failed = false;
+    while(true){
+        std::string chunk(DECOMPRESSION_CHUNK_SIZE, '\0');
+        int n_bytes = gzread(file, &chunk[0], DECOMPRESSION_CHUNK_SIZE);
+        if(n_bytes < 0){
+            is_failed = true;
+            break;
+        }
+        if(n_bytes == 0){
+            break;
+        }
+        chunk.resize(n_bytes);
+        queue.Push(chunk);
+    }
+    gzclose(file);
+    queue.Finish(is_failed);
+#else
+    queue.Finish(true);
+#endif
+}
+
+static void DecompressZstd([[maybe_unused]] const std::string file_path, ChunkQueue &queue)
+{
+#ifdef HAVE_ZSTD
+    FILE *file = fopen(file_path.c_str(), "rb");
+    ZSTD_DStream *dstream = ZSTD_createDStream();
+    if(file == NULL || dstream == NULL){
+        if(file != NULL){
+            fclose(file);
+        }
+        ZSTD_freeDStream(dstream);
+        queue.Finish(true);
+        return;
+    }
+    ZSTD_initDStream(dstream);
+
+    bool is_failed = false;
+    std::vector<char> in_buffer(ZSTD_DStreamInSize());
+    size_t n_read_bytes = 0, last_ret = 0;
+    while((n_read_bytes = fread(in_buffer.data(), 1, in_buffer.size(), file)) > 0 && !is_failed){
+        ZSTD_inBuffer input = {in_buffer.data(), n_read_bytes, 0};
+        while(input.pos < input.size){
+            std::string chunk(ZSTD_DStreamOutSize(), '\0');
+            ZSTD_outBuffer output = {&chunk[0], chunk.size(), 0};
+            last_ret = ZSTD_decompressStream(dstream, &output, &input);
+            if(ZSTD_isError(last_ret)){
+                is_failed = true;
+                break;
+            }
+            if(output.pos > 0){
+                chunk.resize(output.pos);
+                queue.Push(chunk);
+            }
+        }
+    }
+    if(last_ret != 0){ // truncated frame
+        is_failed = true;
+    }
+
+    ZSTD_freeDStream(dstream);
+    fclose(file);
+    queue.Finish(is_failed);
+#else
+    queue.Finish(true);
+#endif
+}
+
+static void ParseDataset(std::vector<std::vector<float>> &dataset, std::istream &file)
+{
     std::string file_row;
     while (getline(file, file_row)){
         std::stringstream ss(file_row);
@@ -45,7 +235,58 @@ static void ReadDataset(std::vector<std::vector<float>> &dataset, const std::str
         }
         dataset.push_back(data_row);
     }
-    file.close();
+}
+
+static void ReadDataset(std::vector<std::vector<float>> &dataset, std::string file_path)
+{
+    // Fall back to the compressed fold file when the plain one is absent, e.g. xxx-5-1tra.dat -> xxx-5-1tra.dat.gz
+    if(!IsFileExist(file_path)){
+        if(IsFileExist(file_path + ".gz")){
+            file_path += ".gz";
+        }
+        else if(IsFileExist(file_path + ".zst")){
+            file_path += ".zst";
+        }
+    }
+
+    CompressionFormat format = DetectCompressionFormat(file_path);
+    if(format == COMPRESSION_NONE){
+        std::ifstream file;
+        file.open(file_path, std::ios::in);
+        if (!file.is_open()){
+            printf("./%s:%d: error: open file error\n", __FILE__, __LINE__);
+            exit(1);
+        }
+        ParseDataset(dataset, file);
+        file.close();
+        return;
+    }
+
+#ifndef HAVE_ZLIB
+    if(format == COMPRESSION_GZIP){
+        printf("./%s:%d: error: built without zlib, cannot read %s\n", __FILE__, __LINE__, file_path.c_str());
+        exit(1);
+    }
+#endif
+#ifndef HAVE_ZSTD
+    if(format == COMPRESSION_ZSTD){
+        printf("./%s:%d: error: built without zstd, cannot read %s\n", __FILE__, __LINE__, file_path.c_str());
+        exit(1);
+    }
+#endif
+
+    // Decompress on a separate thread and parse the chunks as they arrive, without temporary files
+    ChunkQueue queue(DECOMPRESSION_QUEUE_SIZE);
+    std::thread decompressor(format == COMPRESSION_GZIP ? InflateGzip : DecompressZstd, file_path, std::ref(queue));
+    ChunkStreamBuf stream_buf(queue);
+    std::istream file(&stream_buf);
+    ParseDataset(dataset, file);
+    decompressor.join();
+
+    if(queue.IsFailed()){
+        printf("./%s:%d: error: decompress file error\n", __FILE__, __LINE__);
+        exit(1);
+    }
 }
 
 static void Normalize(Dataset &dataset)
@@ -0,0 +1,177 @@
+#include "../inc/hnsw_index.h"
+
+HNSWIndex::HNSWIndex(const std::vector<std::vector<float>> &dataset, const uint32_t ef)
+            :n_data_(dataset.size()), entry_point_(0), max_level_(0)
+{
+    n_features_ = dataset.empty() ? 0 : dataset[0].size() - 1; // the last column of vector stores the label
+    points_.resize(n_data_ * n_features_);
+    for(uint32_t data_idx = 0; data_idx < n_data_; data_idx++){
+        std::copy(dataset[data_idx].begin(), dataset[data_idx].begin() + n_features_, points_.begin() + data_idx * n_features_);
+    }
+
+    // levels are geometric with ratio 1 / HNSW_M, so every layer holds about HNSW_M times fewer rows than the one below
+    std::mt19937 rng(HNSW_SEED);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    const double level_mult = 1. / log((double)HNSW_M);
+
+    links_.resize(n_data_);
+    Scratch scratch = CreateScratch();
+    for(uint32_t data_idx = 0; data_idx < n_data_; data_idx++){
+        const uint32_t level = floor(-log(1. - uniform(rng)) * level_mult);
+        Insert(data_idx, level, ef, scratch);
+    }
+}
+
+HNSWIndex::Scratch HNSWIndex::CreateScratch(void) const
+{
+    return {.visited = std::vector<uint32_t>(n_data_, 0), .epoch = 0};
+}
+
+float HNSWIndex::GetSquareDistance(const float *query, const uint32_t data_idx) const
+{
+    return SquareDistance(query, &points_[data_idx * n_features_], n_features_);
+}
+
+std::vector<std::pair<float, uint32_t>> HNSWIndex::SearchLayer(const float *query, const std::vector<std::pair<float, uint32_t>> &entry_points,
+                                                                const uint32_t ef, const uint32_t level, Scratch &scratch) const
+{
+    if(++scratch.epoch == 0){ // the marks wrapped around, forget them all
+        std::fill(scratch.visited.begin(), scratch.visited.end(), 0);
+        scratch.epoch = 1;
+    }
+
+    typedef std::pair<float, uint32_t> Candidate;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates; // closest first
+    std::priority_queue<Candidate> results;                                                   // farthest first
+    for(const Candidate &entry_point : entry_points){
+        scratch.visited[entry_point.second] = scratch.epoch;
+        candidates.push(entry_point);
+        results.push(entry_point);
+        if(results.size() > ef){
+            results.pop();
+        }
+    }
+
+    while(!candidates.empty()){
+        const Candidate closest = candidates.top();
+        if(results.size() >= ef && results.top() < closest){
+            break; // every candidate left is farther than all results
+        }
+        candidates.pop();
+
+        for(const uint32_t link_idx : links_[closest.second][level]){
+            if(scratch.visited[link_idx] == scratch.epoch){
+                continue;
+            }
+            scratch.visited[link_idx] = scratch.epoch;
+
+            const Candidate candidate = {GetSquareDistance(query, link_idx), link_idx};
+            if(results.size() < ef || candidate < results.top()){
+                candidates.push(candidate);
+                results.push(candidate);
+                if(results.size() > ef){
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> nearest(results.size());
+    for(int rank = results.size() - 1; rank >= 0; rank--){
+        nearest[rank] = results.top();
+        results.pop();
+    }
+
+    return nearest;
+}
+
+std::vector<uint32_t> HNSWIndex::SelectLinks(const std::vector<std::pair<float, uint32_t>> &candidates, const uint32_t max_links) const
+{
+    std::vector<uint32_t> links, pruned;
+    for(const std::pair<float, uint32_t> &candidate : candidates){
+        if(links.size() >= max_links){
+            break;
+        }
+
+        const float *point = &points_[candidate.second * n_features_];
+        bool is_diverse = true;
+        for(const uint32_t link_idx : links){
+            if(GetSquareDistance(point, link_idx) < candidate.first){
+                is_diverse = false;
+                break;
+            }
+        }
+        (is_diverse ? links : pruned).push_back(candidate.second);
+    }
+
+    for(uint32_t pruned_idx = 0; pruned_idx < pruned.size() && links.size() < max_links; pruned_idx++){
+        links.push_back(pruned[pruned_idx]);
+    }
+
+    return links;
+}
+
+void HNSWIndex::Insert(const uint32_t data_idx, const uint32_t level, const uint32_t ef, Scratch &scratch)
+{
+    links_[data_idx].resize(level + 1);
+    if(data_idx == 0){
+        entry_point_ = data_idx;
+        max_level_   = level;
+        return;
+    }
+
+    const float *query = &points_[data_idx * n_features_];
+    std::vector<std::pair<float, uint32_t>> entry_points = {{GetSquareDistance(query, entry_point_), entry_point_}};
+    for(uint32_t layer = max_level_; layer > level; layer--){
+        entry_points = SearchLayer(query, entry_points, 1, layer, scratch);
+    }
+
+    for(int layer = std::min(level, max_level_); layer >= 0; layer--){
+        const std::vector<std::pair<float, uint32_t>> candidates = SearchLayer(query, entry_points, ef, layer, scratch);
+        const uint32_t max_links = (layer == 0) ? 2 * HNSW_M : HNSW_M;
+
+        links_[data_idx][layer] = SelectLinks(candidates, HNSW_M);
+        for(const uint32_t link_idx : links_[data_idx][layer]){
+            std::vector<uint32_t> &back_links = links_[link_idx][layer];
+            back_links.push_back(data_idx);
+            if(back_links.size() > max_links){
+                const float *link_point = &points_[link_idx * n_features_];
+                std::vector<std::pair<float, uint32_t>> link_candidates;
+                link_candidates.reserve(back_links.size());
+                for(const uint32_t back_link_idx : back_links){
+                    link_candidates.emplace_back(GetSquareDistance(link_point, back_link_idx), back_link_idx);
+                }
+                std::sort(link_candidates.begin(), link_candidates.end());
+                back_links = SelectLinks(link_candidates, max_links);
+            }
+        }
+        entry_points = candidates;
+    }
+
+    if(level > max_level_){
+        entry_point_ = data_idx;
+        max_level_   = level;
+    }
+}
+
+void HNSWIndex::FindNearest(const std::vector<float> &query, const uint32_t k, const uint32_t ef, const uint32_t exclude_idx,
+                                Scratch &scratch, std::vector<std::pair<float, uint32_t>> &neighbors) const
+{
+    neighbors.clear();
+    if(k == 0 || n_data_ == 0){
+        return;
+    }
+
+    std::vector<std::pair<float, uint32_t>> entry_points = {{GetSquareDistance(query.data(), entry_point_), entry_point_}};
+    for(uint32_t layer = max_level_; layer > 0; layer--){
+        entry_points = SearchLayer(query.data(), entry_points, 1, layer, scratch);
+    }
+
+    const std::vector<std::pair<float, uint32_t>> candidates = SearchLayer(query.data(), entry_points, std::max(ef, k + 1), 0, scratch);
+    for(uint32_t rank = 0; rank < candidates.size() && neighbors.size() < k; rank++){
+        if(candidates[rank].second != exclude_idx){
+            neighbors.emplace_back(sqrt(candidates[rank].first), candidates[rank].second);
+        }
+    }
+    std::sort(neighbors.begin(), neighbors.end()); // distinct squares can share a square root
+}
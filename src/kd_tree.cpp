@@ -0,0 +1,186 @@
+#include "../inc/kd_tree.h"
+
+KDTree::KDTree(const std::vector<std::vector<float>> &dataset)
+{
+    idxes_.resize(dataset.size());
+    std::iota(idxes_.begin(), idxes_.end(), 0);
+    Build(dataset);
+}
+
+KDTree::KDTree(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &data_idxes)
+            :idxes_(data_idxes)
+{
+    Build(dataset);
+}
+
+void KDTree::Build(const std::vector<std::vector<float>> &dataset)
+{
+    n_features_ = dataset.empty() ? 0 : dataset[0].size() - 1; // the last column of vector stores the label
+    if(idxes_.empty()){
+        return;
+    }
+
+    BuildNode(dataset, 0, idxes_.size());
+
+    points_.resize(idxes_.size() * n_features_);
+    for(uint32_t point_idx = 0; point_idx < idxes_.size(); point_idx++){
+        std::copy(dataset[idxes_[point_idx]].begin(), dataset[idxes_[point_idx]].begin() + n_features_,
+                    points_.begin() + point_idx * n_features_);
+    }
+}
+
+uint32_t KDTree::BuildNode(const std::vector<std::vector<float>> &dataset, const uint32_t begin, const uint32_t end)
+{
+    const uint32_t node_idx = nodes_.size();
+    nodes_.push_back({.begin = begin, .end = end, .left = 0, .right = 0, .split_feature = 0, .split_value = 0.f});
+    lowers_.insert(lowers_.end(), dataset[idxes_[begin]].begin(), dataset[idxes_[begin]].begin() + n_features_);
+    uppers_.insert(uppers_.end(), dataset[idxes_[begin]].begin(), dataset[idxes_[begin]].begin() + n_features_);
+
+    float *lower = &lowers_[node_idx * n_features_];
+    float *upper = &uppers_[node_idx * n_features_];
+    for(uint32_t point_idx = begin + 1; point_idx < end; point_idx++){
+        const std::vector<float> &row = dataset[idxes_[point_idx]];
+        for(uint32_t feature_idx = 0; feature_idx < n_features_; feature_idx++){
+            lower[feature_idx] = std::min(lower[feature_idx], row[feature_idx]);
+            upper[feature_idx] = std::max(upper[feature_idx], row[feature_idx]);
+        }
+    }
+
+    // split the widest feature at its median, unless the rows are few or all identical
+    uint32_t split_feature = 0;
+    for(uint32_t feature_idx = 1; feature_idx < n_features_; feature_idx++){
+        if(upper[feature_idx] - lower[feature_idx] > upper[split_feature] - lower[split_feature]){
+            split_feature = feature_idx;
+        }
+    }
+    if(end - begin <= KD_TREE_LEAF_SIZE || n_features_ == 0 || upper[split_feature] <= lower[split_feature]){
+        return node_idx;
+    }
+
+    const uint32_t mid = begin + (end - begin) / 2;
+    std::nth_element(idxes_.begin() + begin, idxes_.begin() + mid, idxes_.begin() + end,
+        [&](const uint32_t a, const uint32_t b){return dataset[a][split_feature] < dataset[b][split_feature];});
+
+    // children are appended after this node, which invalidates lower and upper
+    const uint32_t left  = BuildNode(dataset, begin, mid);
+    const uint32_t right = BuildNode(dataset, mid, end);
+    nodes_[node_idx].left          = left;
+    nodes_[node_idx].right         = right;
+    nodes_[node_idx].split_feature = split_feature;
+    nodes_[node_idx].split_value   = dataset[idxes_[mid]][split_feature];
+
+    return node_idx;
+}
+
+// Lower bound on the squared distance between query and any row of the node
+float KDTree::GetBoxSquareDistance(const uint32_t node_idx, const float *query) const
+{
+    const float *lower = &lowers_[node_idx * n_features_];
+    const float *upper = &uppers_[node_idx * n_features_];
+
+    float square_distance = 0;
+    for(uint32_t feature_idx = 0; feature_idx < n_features_; feature_idx++){
+        float diff = 0.f;
+        if(query[feature_idx] < lower[feature_idx]){
+            diff = lower[feature_idx] - query[feature_idx];
+        }
+        else if(query[feature_idx] > upper[feature_idx]){
+            diff = query[feature_idx] - upper[feature_idx];
+        }
+        square_distance += diff * diff;
+    }
+
+    return square_distance;
+}
+
+// Upper bound on the squared distance between query and any row of the node
+float KDTree::GetBoxSquareFarthestDistance(const uint32_t node_idx, const float *query) const
+{
+    const float *lower = &lowers_[node_idx * n_features_];
+    const float *upper = &uppers_[node_idx * n_features_];
+
+    float square_distance = 0;
+    for(uint32_t feature_idx = 0; feature_idx < n_features_; feature_idx++){
+        float diff = std::max(query[feature_idx] - lower[feature_idx], upper[feature_idx] - query[feature_idx]);
+        square_distance += diff * diff;
+    }
+
+    return square_distance;
+}
+
+void KDTree::SearchNearest(const uint32_t node_idx, const float *query, const uint32_t k, const uint32_t exclude_idx,
+                            std::vector<std::pair<float, uint32_t>> &heap) const
+{
+    const Node &node = nodes_[node_idx];
+    if(node.left == 0){
+        for(uint32_t point_idx = node.begin; point_idx < node.end; point_idx++){
+            if(idxes_[point_idx] == exclude_idx){
+                continue;
+            }
+
+            const float square_distance = SquareDistance(query, &points_[point_idx * n_features_], n_features_);
+            if(square_distance <= GetSquareDistanceBound(heap, k)){
+                PushNeighbor(heap, k, {sqrt(square_distance), idxes_[point_idx]});
+            }
+        }
+        return;
+    }
+
+    // the side of the split holding the query first, so that the heap bound tightens early
+    const bool left_first = query[node.split_feature] <= node.split_value;
+    const uint32_t children[2] = {left_first ? node.left : node.right, left_first ? node.right : node.left};
+    for(const uint32_t child_idx : children){
+        if(GetBoxSquareDistance(child_idx, query) <= GetSquareDistanceBound(heap, k)){
+            SearchNearest(child_idx, query, k, exclude_idx, heap);
+        }
+    }
+}
+
+void KDTree::SearchFarthest(const uint32_t node_idx, const float *query, const uint32_t k, std::vector<std::pair<float, uint32_t>> &heap) const
+{
+    const Node &node = nodes_[node_idx];
+    if(node.left == 0){
+        for(uint32_t point_idx = node.begin; point_idx < node.end; point_idx++){
+            const float square_distance = SquareDistance(query, &points_[point_idx * n_features_], n_features_);
+            PushNeighbor(heap, k, {-sqrt(square_distance), idxes_[point_idx]});
+        }
+        return;
+    }
+
+    // the side away from the query first; a node is skipped when even its farthest corner is closer than
+    // the nearest kept row, with the same margin as the nearest search so that ties are kept
+    const bool left_first = query[node.split_feature] > node.split_value;
+    const uint32_t children[2] = {left_first ? node.left : node.right, left_first ? node.right : node.left};
+    for(const uint32_t child_idx : children){
+        if(heap.size() < k ||
+            GetBoxSquareFarthestDistance(child_idx, query) * (1.f + KNN_BOUND_MARGIN) >= heap.front().first * heap.front().first){
+            SearchFarthest(child_idx, query, k, heap);
+        }
+    }
+}
+
+void KDTree::FindNearest(const std::vector<float> &query, const uint32_t k, const uint32_t exclude_idx,
+                            std::vector<std::pair<float, uint32_t>> &neighbors) const
+{
+    neighbors.clear();
+    if(k == 0 || idxes_.empty()){
+        return;
+    }
+
+    SearchNearest(0, query.data(), k, exclude_idx, neighbors);
+    std::sort_heap(neighbors.begin(), neighbors.end());
+}
+
+void KDTree::FindFarthest(const std::vector<float> &query, const uint32_t k, std::vector<std::pair<float, uint32_t>> &neighbors) const
+{
+    neighbors.clear();
+    if(k == 0 || idxes_.empty()){
+        return;
+    }
+
+    SearchFarthest(0, query.data(), k, neighbors);
+    std::sort_heap(neighbors.begin(), neighbors.end()); // ascending (-distance, index)
+    for(std::pair<float, uint32_t> &neighbor : neighbors){
+        neighbor.first = -neighbor.first;
+    }
+}
@@ -0,0 +1,370 @@
+#include "../inc/metrics_accumulator.h"
+
+MetricsAccumulator::MetricsAccumulator(const uint32_t n_classes)
+                        :n_classes(n_classes), n_data(0)
+{
+    confusion_matrix.resize((n_classes + 1) * (n_classes + 1), 0);
+}
+
+void MetricsAccumulator::Add(const std::vector<float> &predict_prob, const uint32_t actual_label)
+{
+    std::vector<uint64_t> &class_counts = score_class_counts[predict_prob];
+    if(class_counts.empty()){
+        class_counts.resize(n_classes + 1, 0);
+    }
+    class_counts[actual_label]++;
+
+    uint32_t predicted_label = std::distance(predict_prob.begin(), std::max_element(predict_prob.begin() + 1, predict_prob.end()));
+    confusion_matrix[predicted_label * (n_classes + 1) + actual_label]++;
+    n_data++;
+}
+
+void MetricsAccumulator::AddGroup(const std::vector<float> &predict_prob, const std::vector<uint32_t> &class_counts)
+{
+    const uint64_t n_group_data = std::accumulate(class_counts.begin() + 1, class_counts.end(), (uint64_t)0);
+    if(n_group_data == 0){
+        return;
+    }
+
+    std::vector<uint64_t> &group_class_counts = score_class_counts[predict_prob];
+    if(group_class_counts.empty()){
+        group_class_counts.resize(n_classes + 1, 0);
+    }
+
+    uint32_t predicted_label = std::distance(predict_prob.begin(), std::max_element(predict_prob.begin() + 1, predict_prob.end()));
+    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+        group_class_counts[class_idx] += class_counts[class_idx];
+        confusion_matrix[predicted_label * (n_classes + 1) + class_idx] += class_counts[class_idx];
+    }
+    n_data += n_group_data;
+}
+
+void MetricsAccumulator::Merge(const MetricsAccumulator &other)
+{
+    if(other.n_classes != n_classes){
+        printf("./%s:%d: error: cannot merge accumulators of %u and %u classes\n", __FILE__, __LINE__, n_classes, other.n_classes);
+        exit(1);
+    }
+
+    for(uint32_t cell_idx = 0; cell_idx < confusion_matrix.size(); cell_idx++){
+        confusion_matrix[cell_idx] += other.confusion_matrix[cell_idx];
+    }
+    for(const auto &group : other.score_class_counts){
+        std::vector<uint64_t> &class_counts = score_class_counts[group.first];
+        if(class_counts.empty()){
+            class_counts.resize(n_classes + 1, 0);
+        }
+        for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+            class_counts[class_idx] += group.second[class_idx];
+        }
+    }
+    n_data += other.n_data;
+}
+
+void MetricsAccumulator::Reset(void)
+{
+    std::fill(confusion_matrix.begin(), confusion_matrix.end(), 0);
+    score_class_counts.clear();
+    n_data = 0;
+}
+
+MetricsAccumulator::GroupTable MetricsAccumulator::BuildGroupTable(const uint32_t n_threads) const
+{
+    GroupTable table;
+    table.n_groups = score_class_counts.size();
+    table.probs.reserve(table.n_groups);
+    table.predicted_labels.reserve(table.n_groups);
+    for(const auto &group : score_class_counts){
+        const std::vector<float> &predict_prob = group.first;
+        table.probs.push_back(&predict_prob);
+        table.predicted_labels.push_back(std::distance(predict_prob.begin(), std::max_element(predict_prob.begin() + 1, predict_prob.end())));
+    }
+
+    table.sorted_group_idxes.resize(n_classes + 1);
+    ParallelFor(n_classes, n_threads, [&](const uint32_t task_idx, const uint32_t){
+        const uint32_t class_idx = task_idx + 1;
+        std::vector<uint32_t> &sorted_group_idxes = table.sorted_group_idxes[class_idx];
+        sorted_group_idxes.resize(table.n_groups);
+        std::iota(sorted_group_idxes.begin(), sorted_group_idxes.end(), 0);
+        std::sort(sorted_group_idxes.begin(), sorted_group_idxes.end(), [&](const uint32_t a, const uint32_t b){
+            return (*table.probs[a])[class_idx] > (*table.probs[b])[class_idx];
+        });
+    });
+
+    return table;
+}
+
+// Groups with equal scores for pos_label are tied and contribute one diagonal segment of the ROC curve,
+// so the cost is a walk over the distinct probability rows instead of a sort of the testing data.
+float MetricsAccumulator::CalculateOVRAUC(const GroupTable &table, const std::vector<uint64_t> &group_class_counts, const uint32_t pos_label) const
+{
+    const uint32_t n_columns = n_classes + 1;
+    const std::vector<uint32_t> &sorted_group_idxes = table.sorted_group_idxes[pos_label];
+
+    double AUC = 0.0;
+    uint64_t tp = 0, tp_prev = 0, fp = 0, fp_prev = 0;
+    // Lower the threshold one distinct score at a time and compute (FP, TP) pairs to generate ROC points.
+    for(uint32_t sorted_idx = 0; sorted_idx < table.n_groups;){
+        const float score = (*table.probs[sorted_group_idxes[sorted_idx]])[pos_label];
+        tp_prev = tp;
+        fp_prev = fp;
+        for(; sorted_idx < table.n_groups && (*table.probs[sorted_group_idxes[sorted_idx]])[pos_label] == score; sorted_idx++){
+            const uint64_t *class_counts = &group_class_counts[(size_t)sorted_group_idxes[sorted_idx] * n_columns];
+            const uint64_t n_group_data = std::accumulate(class_counts + 1, class_counts + n_columns, (uint64_t)0);
+            tp += class_counts[pos_label];
+            fp += n_group_data - class_counts[pos_label];
+        }
+
+        // Integrate the ROC curve using trapezoid method
+        AUC += (double)(tp + tp_prev) * (fp - fp_prev) / 2;
+    }
+
+    const uint64_t n_pos_label = tp;
+    const uint64_t n_neg_label = fp;
+
+    if(n_pos_label == 0 || n_neg_label == 0){
+        return 0.f;
+    }
+    else{
+        return AUC / ((double)n_pos_label * n_neg_label);
+    }
+}
+
+float MetricsAccumulator::CalculateMAUC(const GroupTable &table, const std::vector<uint64_t> &group_class_counts, 
+                                            const bool macro_flag, const uint32_t n_threads) const
+{
+    const uint32_t n_columns = n_classes + 1;
+    std::vector<uint64_t> class_counts(n_columns, 0);
+    for(uint32_t group_idx = 0; group_idx < table.n_groups; group_idx++){
+        for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+            class_counts[class_idx] += group_class_counts[(size_t)group_idx * n_columns + class_idx];
+        }
+    }
+
+    // One class per task; the classes are combined in order so the result does not depend on n_threads.
+    std::vector<float> class_AUCs(n_columns, 0.f);
+    ParallelFor(n_classes, n_threads, [&](const uint32_t task_idx, const uint32_t){
+        const uint32_t class_idx = task_idx + 1;
+        if(class_counts[class_idx] > 0){
+            class_AUCs[class_idx] = CalculateOVRAUC(table, group_class_counts, class_idx);
+        }
+    });
+
+    float MAUC = 0.f;
+    uint32_t n_testing_classes = 0, minority_class_idx = 1;
+    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+        if(class_counts[class_idx] > 0){ // n_testing_classes <= n_training_classes
+            n_testing_classes++;
+            float AUC = class_AUCs[class_idx];
+            if(n_classes == 2 && !macro_flag){
+                if(class_counts[class_idx] <= class_counts[minority_class_idx]){
+                    MAUC = AUC;
+                }
+            }
+            else{
+                MAUC += AUC;
+            }
+        }
+    }
+    if(n_classes > 2 || macro_flag){
+        MAUC /= n_testing_classes;
+    }
+
+    return MAUC;
+}
+
+void MetricsAccumulator::ComputeConfusionMetrics(const std::vector<uint64_t> &confusion_matrix, Metrics &metrics) const
+{
+    auto confusion = [&](const uint32_t predicted_label, const uint32_t actual_label){
+        return confusion_matrix[predicted_label * (n_classes + 1) + actual_label];
+    };
+
+    metrics.macro_precision = 0.f;
+    metrics.macro_recall    = 0.f;
+    metrics.macro_f1        = 0.f;
+    metrics.g_mean          = 1.f;
+    metrics.MACC            = 0.f;
+    metrics.MMCC            = 0.f;
+
+    uint64_t n_testing_data = 0;
+    uint32_t n_testing_classes = 0; // n_testing_classes <= n_training_classes
+
+    uint64_t n0 = 0, nc = 0; // Cohen's Kappa = (n0 / n - nc / n^2) / (1 - nc / n)
+
+    uint64_t min_class_size = std::numeric_limits<uint64_t>::max();
+    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+        int64_t tp = 0, fp = 0, fn = 0, tn = 0; // uint32_t is not large enough to calculate MCC.
+        uint64_t actual_class_count = 0, predict_class_count = 0;
+
+        tp  = confusion(class_idx, class_idx);
+        n0 += confusion(class_idx, class_idx);
+
+        for(uint32_t col_idx = 1; col_idx <= n_classes; col_idx++){
+            predict_class_count += confusion(class_idx, col_idx);
+            tn += confusion(col_idx, col_idx);
+        }
+        fp  = predict_class_count - tp;
+        tn -= tp;
+
+        for(uint32_t row_idx = 1; row_idx <= n_classes; row_idx++){
+            actual_class_count += confusion(row_idx, class_idx);
+        }
+        n_testing_data += actual_class_count;
+        fn  = actual_class_count - tp;
+        nc += predict_class_count * actual_class_count;
+
+        if((tp + fn) > 0){ // Compute only if the class exists in the testing set.
+            n_testing_classes++;
+
+            float precision = 0.f;
+            if((tp + fp) > 0){
+                precision = (float)tp / (tp + fp);
+            }
+
+            float recall = 0.f;
+            if((tp + fn) > 0){
+                recall = (float)tp / (tp + fn);
+            }
+
+            float f1_score = 0.f;
+            if((precision + recall) > 0){
+                f1_score = 2 * precision * recall / (precision + recall);
+            }
+
+            float ACC = (float)(tp + tn) / (tp + fp + fn + tn);
+
+            float MCC = 0.f;
+            if((tp + fp) > 0 && (tp + fn) > 0 && (tn + fp) > 0 && (tn + fn) > 0){
+                MCC = (tp * tn - fp * fn) / sqrt((double)(tp + fp) * (tp + fn) * (tn + fp) * (tn + fn));
+            }
+
+            if(n_classes == 2){
+                if(actual_class_count < min_class_size){
+                    metrics.macro_precision = precision;
+                    metrics.macro_recall    = recall;
+                    metrics.macro_f1        = f1_score;
+                    metrics.MACC            = ACC;
+                    metrics.MMCC            = MCC;
+                }
+            }
+            else{
+                metrics.macro_precision += precision;
+                metrics.macro_recall    += recall;
+                metrics.macro_f1        += f1_score;
+                metrics.MACC            += ACC;
+                metrics.MMCC            += MCC;
+            }
+            metrics.g_mean *= recall;
+        }
+    }
+
+    if(n_classes > 2){
+        metrics.macro_precision /= n_testing_classes;
+        metrics.macro_recall    /= n_testing_classes;
+        metrics.macro_f1        /= n_testing_classes;
+        metrics.MACC            /= n_testing_classes;
+        metrics.MMCC            /= n_testing_classes;
+    }
+    metrics.g_mean = pow(metrics.g_mean, 1.f / n_testing_classes);
+
+    float p0 = (float)n0 / n_testing_data;
+    float pc = (float)nc / (n_testing_data * n_testing_data);
+    metrics.Cohens_Kappa = (p0 - pc) / (1 - pc);
+}
+
+Metrics MetricsAccumulator::ComputeMetrics(const bool macro_flag, const uint32_t n_threads) const
+{
+    const GroupTable table = BuildGroupTable(n_threads);
+    std::vector<uint64_t> group_class_counts;
+    group_class_counts.reserve((size_t)table.n_groups * (n_classes + 1));
+    for(const auto &group : score_class_counts){
+        group_class_counts.insert(group_class_counts.end(), group.second.begin(), group.second.end());
+    }
+
+    Metrics metrics;
+    ComputeConfusionMetrics(confusion_matrix, metrics);
+    metrics.MAUC = CalculateMAUC(table, group_class_counts, macro_flag, n_threads);
+
+    return metrics;
+}
+
+// Every field of Metrics, in declaration order
+static float Metrics::*const METRIC_FIELDS[] = {
+    &Metrics::macro_precision, &Metrics::macro_recall, &Metrics::macro_f1, &Metrics::g_mean,
+    &Metrics::MACC, &Metrics::MAUC, &Metrics::MMCC, &Metrics::Cohens_Kappa
+};
+
+MetricsInterval MetricsAccumulator::ComputeBootstrapIntervals(const uint32_t n_resamples, const float confidence_level, const uint64_t n_draws,
+                                                                const uint64_t seed, const bool macro_flag, const uint32_t n_threads) const
+{
+    const uint32_t n_columns = n_classes + 1;
+    const GroupTable table = BuildGroupTable(n_threads);
+    const uint64_t n_resampled_data = (n_draws > 0) ? n_draws : n_data;
+
+    // Drawing n predictions with replacement only matters through how many land in each (group, label) cell,
+    // i.e. a multinomial over the non-empty cells, sampled as a chain of binomials in O(n_cells) per resample.
+    std::vector<uint32_t> cell_idxes; // group_idx * n_columns + label
+    std::vector<double> cell_weights;
+    uint32_t group_idx = 0;
+    for(const auto &group : score_class_counts){
+        for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+            if(group.second[class_idx] > 0){
+                cell_idxes.push_back(group_idx * n_columns + class_idx);
+                cell_weights.push_back(group.second[class_idx]);
+            }
+        }
+        group_idx++;
+    }
+
+    std::vector<Metrics> resampled_metrics(n_resamples);
+    ParallelFor(n_resamples, n_threads, [&](const uint32_t resample_idx, const uint32_t){
+        std::mt19937_64 generator(seed + resample_idx);
+        std::vector<uint64_t> group_class_counts((size_t)table.n_groups * n_columns, 0);
+        std::vector<uint64_t> resampled_confusion_matrix(n_columns * n_columns, 0);
+
+        uint64_t n_remaining_draws = n_resampled_data;
+        double remaining_weight = n_data;
+        for(uint32_t cell_idx = 0; cell_idx < cell_idxes.size() && n_remaining_draws > 0; cell_idx++){
+            uint64_t n_cell_draws = n_remaining_draws;
+            if(cell_idx + 1 < cell_idxes.size()){
+                std::binomial_distribution<uint64_t> binomial(n_remaining_draws, std::min(cell_weights[cell_idx] / remaining_weight, 1.0));
+                n_cell_draws = binomial(generator);
+            }
+            n_remaining_draws -= n_cell_draws;
+            remaining_weight  -= cell_weights[cell_idx];
+
+            const uint32_t cell_group_idx = cell_idxes[cell_idx] / n_columns;
+            const uint32_t cell_label = cell_idxes[cell_idx] % n_columns;
+            group_class_counts[cell_idxes[cell_idx]] += n_cell_draws;
+            resampled_confusion_matrix[table.predicted_labels[cell_group_idx] * n_columns + cell_label] += n_cell_draws;
+        }
+
+        Metrics &metrics = resampled_metrics[resample_idx];
+        ComputeConfusionMetrics(resampled_confusion_matrix, metrics);
+        metrics.MAUC = CalculateMAUC(table, group_class_counts, macro_flag, 1);
+    });
+
+    // Percentile interval of each metric; resamples where a metric is undefined (NaN) are left out
+    const float alpha = 1.f - confidence_level;
+    MetricsInterval interval;
+    std::vector<float> values;
+    for(float Metrics::*const field : METRIC_FIELDS){
+        values.clear();
+        for(uint32_t resample_idx = 0; resample_idx < n_resamples; resample_idx++){
+            float value = resampled_metrics[resample_idx].*field;
+            if(!std::isnan(value)){
+                values.push_back(value);
+            }
+        }
+        if(values.empty()){
+            interval.lower.*field = interval.upper.*field = std::numeric_limits<float>::quiet_NaN();
+            continue;
+        }
+
+        std::sort(values.begin(), values.end());
+        interval.lower.*field = values[(size_t)std::round(alpha / 2 * (values.size() - 1))];
+        interval.upper.*field = values[(size_t)std::round((1 - alpha / 2) * (values.size() - 1))];
+    }
+
+    return interval;
+}
@@ -0,0 +1,382 @@
+#include "../inc/nearest_neighbors.h"
+#include "../inc/kd_tree.h"
+#include "../inc/hnsw_index.h"
+
+static_assert(KNN_QUERY_BLOCK_SIZE % DISTANCE_PANEL_WIDTH == 0 && KNN_DATA_BLOCK_SIZE % DISTANCE_PANEL_WIDTH == 0,
+                "data blocks must start on a panel of the block kernel");
+
+static bool UseKDTree(const NeighborSearch search, const DistanceMatrix *dist_cache, const uint32_t n_data, const uint32_t n_features, 
+                        const bool farthest)
+{
+    if(search == NEIGHBOR_SEARCH_AUTO || search == NEIGHBOR_SEARCH_HNSW){ // the graph only answers nearest queries
+        // farthest rows lie on the hull of the data, where the boxes prune well in any dimension
+        const double min_data = farthest ? KNN_KD_TREE_MIN_FARTHEST : KNN_KD_TREE_MIN_DATA * pow(KNN_KD_TREE_FEATURE_GROWTH, (double)n_features);
+        return dist_cache == nullptr && n_data >= min_data;
+    }
+    return search == NEIGHBOR_SEARCH_KD_TREE;
+}
+
+// Distance between two rows of dataset, from dist_cache when it is given
+static inline float GetDistance(const std::vector<std::vector<float>> &dataset, const DistanceMatrix *dist_cache,
+                                    const std::vector<uint32_t> *cache_idxes, const uint32_t src_idx, const uint32_t dst_idx)
+{
+    if(dist_cache != nullptr){
+        return (cache_idxes != nullptr) ? dist_cache->GetDistance((*cache_idxes)[src_idx], (*cache_idxes)[dst_idx]) : 
+                                            dist_cache->GetDistance(src_idx, dst_idx);
+    }
+
+    return EuclideanDistance(dataset[src_idx], dataset[dst_idx]);
+}
+
+static void WriteNeighbors(std::vector<std::pair<float, uint32_t>> &heap, const uint32_t query_idx, NeighborLists &neighbors)
+{
+    std::sort_heap(heap.begin(), heap.end());
+    for(uint32_t rank = 0; rank < heap.size(); rank++){
+        neighbors.dists[neighbors.offsets[query_idx] + rank] = heap[rank].first;
+        neighbors.idxes[neighbors.offsets[query_idx] + rank] = heap[rank].second;
+    }
+}
+
+NeighborLists FindKNearestNeighbors(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &ks,
+                                        const uint32_t n_threads, const DistanceMatrix *dist_cache,
+                                        const NeighborSearch search, const std::vector<uint32_t> *cache_idxes, const uint32_t hnsw_ef)
+{
+    const uint32_t n_data = dataset.size();
+    if(dist_cache != nullptr && cache_idxes == nullptr && dist_cache->GetNumData() != n_data){
+        printf("./%s:%d: error: distance cache does not match the dataset\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    NeighborLists neighbors;
+    neighbors.offsets.resize(n_data + 1, 0);
+    for(uint32_t query_idx = 0; query_idx < n_data; query_idx++){
+        neighbors.offsets[query_idx + 1] = neighbors.offsets[query_idx] + std::min(ks[query_idx], n_data - 1);
+    }
+    neighbors.idxes.resize(neighbors.offsets[n_data]);
+    neighbors.dists.resize(neighbors.offsets[n_data]);
+
+    const uint32_t n_blocks = (n_data + KNN_QUERY_BLOCK_SIZE - 1) / KNN_QUERY_BLOCK_SIZE;
+    if(n_data > 0 && search == NEIGHBOR_SEARCH_HNSW){
+        const HNSWIndex hnsw_index(dataset, hnsw_ef);
+        std::vector<HNSWIndex::Scratch> scratches(std::max(n_threads, 1u), hnsw_index.CreateScratch());
+        ParallelFor(n_blocks, n_threads, [&](const uint32_t query_block_idx, const uint32_t thread_idx){
+            const uint32_t query_begin = query_block_idx * KNN_QUERY_BLOCK_SIZE;
+            const uint32_t query_end = std::min(query_begin + KNN_QUERY_BLOCK_SIZE, n_data);
+
+            std::vector<std::pair<float, uint32_t>> query_neighbors;
+            for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+                const uint32_t k = neighbors.GetNumNeighbors(query_idx);
+                hnsw_index.FindNearest(dataset[query_idx], k, hnsw_ef, query_idx, scratches[thread_idx], query_neighbors);
+                if(query_neighbors.size() < k){ // the graph did not reach enough rows, scan them all
+                    query_neighbors.clear();
+                    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+                        if(data_idx != query_idx){
+                            PushNeighbor(query_neighbors, k, {EuclideanDistance(dataset[query_idx], dataset[data_idx]), data_idx});
+                        }
+                    }
+                    std::sort_heap(query_neighbors.begin(), query_neighbors.end());
+                }
+                for(uint32_t rank = 0; rank < query_neighbors.size(); rank++){
+                    neighbors.dists[neighbors.offsets[query_idx] + rank] = query_neighbors[rank].first;
+                    neighbors.idxes[neighbors.offsets[query_idx] + rank] = query_neighbors[rank].second;
+                }
+            }
+        });
+        return neighbors;
+    }
+
+    if(n_data > 0 && UseKDTree(search, dist_cache, n_data, dataset[0].size() - 1, false)){
+        const KDTree kd_tree(dataset);
+        ParallelFor(n_blocks, n_threads, [&](const uint32_t query_block_idx, const uint32_t){
+            const uint32_t query_begin = query_block_idx * KNN_QUERY_BLOCK_SIZE;
+            const uint32_t query_end = std::min(query_begin + KNN_QUERY_BLOCK_SIZE, n_data);
+
+            std::vector<std::pair<float, uint32_t>> query_neighbors;
+            for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+                kd_tree.FindNearest(dataset[query_idx], neighbors.GetNumNeighbors(query_idx), query_idx, query_neighbors);
+                for(uint32_t rank = 0; rank < query_neighbors.size(); rank++){
+                    neighbors.dists[neighbors.offsets[query_idx] + rank] = query_neighbors[rank].first;
+                    neighbors.idxes[neighbors.offsets[query_idx] + rank] = query_neighbors[rank].second;
+                }
+            }
+        });
+        return neighbors;
+    }
+
+    // Without a cache, a tile of approximate distances from the block kernel screens the pairs, and only
+    // those that may enter a heap are computed exactly, so the neighbors are the same as without screening.
+    std::unique_ptr<DistancePanels> panels;
+    if(dist_cache == nullptr){
+        panels = std::make_unique<DistancePanels>(dataset);
+    }
+
+    if(n_threads <= 1){
+        // Every pair is computed once for both of its rows: each tile of the upper triangle
+        // updates the heaps of its queries and of its data rows.
+        std::vector<std::vector<std::pair<float, uint32_t>>> heaps(n_data);
+        for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+            heaps[data_idx].reserve(neighbors.GetNumNeighbors(data_idx));
+        }
+        std::vector<float> tile(KNN_QUERY_BLOCK_SIZE * KNN_DATA_BLOCK_SIZE);
+        for(uint32_t query_begin = 0; query_begin < n_data; query_begin += KNN_QUERY_BLOCK_SIZE){
+            const uint32_t query_end = std::min(query_begin + KNN_QUERY_BLOCK_SIZE, n_data);
+            for(uint32_t data_begin = query_begin; data_begin < n_data; data_begin += KNN_DATA_BLOCK_SIZE){
+                const uint32_t data_end = std::min(data_begin + KNN_DATA_BLOCK_SIZE, n_data);
+                const uint32_t stride = DistancePanels::GetBlockStride(data_begin, data_end);
+                if(panels != nullptr){
+                    panels->ComputeApproxSquareDistances(query_begin, query_end, data_begin, data_end, tile.data());
+                }
+                for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+                    const uint32_t query_k = neighbors.GetNumNeighbors(query_idx);
+                    for(uint32_t data_idx = std::max(data_begin, query_idx + 1); data_idx < data_end; data_idx++){
+                        const uint32_t data_k = neighbors.GetNumNeighbors(data_idx);
+                        if(panels != nullptr && tile[(query_idx - query_begin) * stride + data_idx - data_begin] - panels->GetErrorBound(query_idx, data_idx) >
+                                                    std::max(GetSquareDistanceBound(heaps[query_idx], query_k), GetSquareDistanceBound(heaps[data_idx], data_k))){
+                            continue;
+                        }
+                        const float dist = GetDistance(dataset, dist_cache, cache_idxes, query_idx, data_idx);
+                        PushNeighbor(heaps[query_idx], query_k, {dist, data_idx});
+                        PushNeighbor(heaps[data_idx], data_k, {dist, query_idx});
+                    }
+                }
+            }
+            for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+                WriteNeighbors(heaps[query_idx], query_idx, neighbors); // Every pair of these rows has been seen
+                std::vector<std::pair<float, uint32_t>>().swap(heaps[query_idx]);
+            }
+        }
+        return neighbors;
+    }
+
+    // Each worker owns the heaps of one block of queries and scans all data blocks for them
+    ParallelFor(n_blocks, n_threads, [&](const uint32_t query_block_idx, const uint32_t){
+        const uint32_t query_begin = query_block_idx * KNN_QUERY_BLOCK_SIZE;
+        const uint32_t query_end = std::min(query_begin + KNN_QUERY_BLOCK_SIZE, n_data);
+
+        std::vector<std::vector<std::pair<float, uint32_t>>> heaps(query_end - query_begin);
+        std::vector<float> tile(KNN_QUERY_BLOCK_SIZE * KNN_DATA_BLOCK_SIZE);
+        for(uint32_t data_begin = 0; data_begin < n_data; data_begin += KNN_DATA_BLOCK_SIZE){
+            const uint32_t data_end = std::min(data_begin + KNN_DATA_BLOCK_SIZE, n_data);
+            const uint32_t stride = DistancePanels::GetBlockStride(data_begin, data_end);
+            if(panels != nullptr){
+                panels->ComputeApproxSquareDistances(query_begin, query_end, data_begin, data_end, tile.data());
+            }
+            for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+                const uint32_t k = neighbors.GetNumNeighbors(query_idx);
+                std::vector<std::pair<float, uint32_t>> &heap = heaps[query_idx - query_begin];
+                for(uint32_t data_idx = data_begin; data_idx < data_end; data_idx++){
+                    if(data_idx == query_idx || (panels != nullptr &&
+                        tile[(query_idx - query_begin) * stride + data_idx - data_begin] - panels->GetErrorBound(query_idx, data_idx) >
+                            GetSquareDistanceBound(heap, k))){
+                        continue;
+                    }
+                    PushNeighbor(heap, k, {GetDistance(dataset, dist_cache, cache_idxes, query_idx, data_idx), data_idx});
+                }
+            }
+        }
+
+        for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+            WriteNeighbors(heaps[query_idx - query_begin], query_idx, neighbors);
+        }
+    });
+
+    return neighbors;
+}
+
+NeighborLists FindKFarthestNeighbors(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &query_idxes,
+                                        const std::vector<uint32_t> &data_idxes, const std::vector<uint32_t> &ks,
+                                        const uint32_t n_threads, const DistanceMatrix *dist_cache, const NeighborSearch search,
+                                        const std::vector<uint32_t> *cache_idxes)
+{
+    const uint32_t n_queries = query_idxes.size();
+    const uint32_t n_data = data_idxes.size();
+    if(dist_cache != nullptr && cache_idxes == nullptr && dist_cache->GetNumData() != dataset.size()){
+        printf("./%s:%d: error: distance cache does not match the dataset\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    NeighborLists neighbors;
+    neighbors.offsets.resize(n_queries + 1, 0);
+    for(uint32_t query_idx = 0; query_idx < n_queries; query_idx++){
+        neighbors.offsets[query_idx + 1] = neighbors.offsets[query_idx] + std::min(ks[query_idx], n_data);
+    }
+    neighbors.idxes.resize(neighbors.offsets[n_queries]);
+    neighbors.dists.resize(neighbors.offsets[n_queries]);
+    if(n_queries == 0 || n_data == 0){
+        return neighbors;
+    }
+
+    std::unique_ptr<KDTree> kd_tree;
+    if(UseKDTree(search, dist_cache, n_data, dataset[0].size() - 1, true)){
+        kd_tree = std::make_unique<KDTree>(dataset, data_idxes);
+    }
+
+    const uint32_t n_blocks = (n_queries + KNN_QUERY_BLOCK_SIZE - 1) / KNN_QUERY_BLOCK_SIZE;
+    ParallelFor(n_blocks, n_threads, [&](const uint32_t query_block_idx, const uint32_t){
+        const uint32_t query_begin = query_block_idx * KNN_QUERY_BLOCK_SIZE;
+        const uint32_t query_end = std::min(query_begin + KNN_QUERY_BLOCK_SIZE, n_queries);
+
+        std::vector<std::pair<float, uint32_t>> heap;
+        for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+            const uint32_t k = neighbors.GetNumNeighbors(query_idx);
+            const uint32_t src_idx = query_idxes[query_idx];
+            if(kd_tree != nullptr){
+                kd_tree->FindFarthest(dataset[src_idx], k, heap);
+            }
+            else{
+                // (-distance, index) keys, so that the max-heap keeps the farthest rows
+                heap.clear();
+                if(dist_cache != nullptr && cache_idxes != nullptr){
+                    const uint32_t src_row = (*cache_idxes)[src_idx];
+                    for(const uint32_t dst_idx : data_idxes){
+                        PushNeighbor(heap, k, {-dist_cache->GetDistance(src_row, (*cache_idxes)[dst_idx]), dst_idx});
+                    }
+                }
+                else{
+                    for(const uint32_t dst_idx : data_idxes){
+                        PushNeighbor(heap, k, {-GetDistance(dataset, dist_cache, nullptr, src_idx, dst_idx), dst_idx});
+                    }
+                }
+                std::sort_heap(heap.begin(), heap.end());
+                for(std::pair<float, uint32_t> &neighbor : heap){
+                    neighbor.first = -neighbor.first;
+                }
+            }
+
+            for(uint32_t rank = 0; rank < heap.size(); rank++){
+                neighbors.dists[neighbors.offsets[query_idx] + rank] = heap[rank].first;
+                neighbors.idxes[neighbors.offsets[query_idx] + rank] = heap[rank].second;
+            }
+        }
+    });
+
+    return neighbors;
+}
+
+NeighborLists ReverseNeighbors(const NeighborLists &neighbors, const std::vector<uint32_t> &n_kept, const uint32_t n_data)
+{
+    const uint32_t n_queries = neighbors.offsets.size() - 1;
+
+    NeighborLists reverse;
+    reverse.offsets.resize(n_data + 1, 0);
+    for(uint32_t query_idx = 0; query_idx < n_queries; query_idx++){
+        const uint32_t n_edges = std::min(n_kept[query_idx], neighbors.GetNumNeighbors(query_idx));
+        for(uint32_t rank = 0; rank < n_edges; rank++){
+            reverse.offsets[neighbors.idxes[neighbors.offsets[query_idx] + rank] + 1]++;
+        }
+    }
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        reverse.offsets[data_idx + 1] += reverse.offsets[data_idx];
+    }
+
+    reverse.idxes.resize(reverse.offsets[n_data]);
+    reverse.dists.resize(reverse.offsets[n_data]);
+    std::vector<uint32_t> ends(reverse.offsets.begin(), reverse.offsets.end() - 1);
+    for(uint32_t query_idx = 0; query_idx < n_queries; query_idx++){
+        const uint32_t n_edges = std::min(n_kept[query_idx], neighbors.GetNumNeighbors(query_idx));
+        for(uint32_t rank = 0; rank < n_edges; rank++){
+            const uint32_t edge_idx = ends[neighbors.idxes[neighbors.offsets[query_idx] + rank]]++;
+            reverse.idxes[edge_idx] = query_idx;
+            reverse.dists[edge_idx] = neighbors.dists[neighbors.offsets[query_idx] + rank];
+        }
+    }
+
+    return reverse;
+}
+
+NeighborGraph::NeighborGraph(const std::vector<std::vector<float>> &dataset, const uint32_t k, const uint32_t n_threads)
+                                :dataset_(dataset)
+{
+    const std::vector<uint32_t> ks(dataset.size(), k);
+    neighbors_ = ::FindKNearestNeighbors(dataset, ks, n_threads);
+}
+
+NeighborLists NeighborGraph::FindKNearestNeighbors(const std::vector<uint32_t> &row_idxes, const std::vector<uint32_t> &ks,
+                                                        const uint32_t n_threads) const
+{
+    const uint32_t n_data = row_idxes.size();
+    if(dataset_.size() < n_data){
+        printf("./%s:%d: error: neighbor graph does not match the dataset\n", __FILE__, __LINE__);
+        exit(1);
+    }
+
+    NeighborLists neighbors;
+    neighbors.offsets.resize(n_data + 1, 0);
+    for(uint32_t query_idx = 0; query_idx < n_data; query_idx++){
+        neighbors.offsets[query_idx + 1] = neighbors.offsets[query_idx] + std::min(ks[query_idx], n_data - 1);
+    }
+    neighbors.idxes.resize(neighbors.offsets[n_data]);
+    neighbors.dists.resize(neighbors.offsets[n_data]);
+
+    const uint32_t not_in_subset = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> subset_idxes(dataset_.size(), not_in_subset); // inverse of row_idxes
+    for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+        subset_idxes[row_idxes[data_idx]] = data_idx;
+    }
+
+    const uint32_t n_blocks = (n_data + KNN_QUERY_BLOCK_SIZE - 1) / KNN_QUERY_BLOCK_SIZE;
+    ParallelFor(n_blocks, n_threads, [&](const uint32_t query_block_idx, const uint32_t){
+        const uint32_t query_begin = query_block_idx * KNN_QUERY_BLOCK_SIZE;
+        const uint32_t query_end = std::min(query_begin + KNN_QUERY_BLOCK_SIZE, n_data);
+
+        std::vector<std::pair<float, uint32_t>> query_neighbors;
+        for(uint32_t query_idx = query_begin; query_idx < query_end; query_idx++){
+            const uint32_t k = neighbors.GetNumNeighbors(query_idx);
+            const uint32_t row_idx = row_idxes[query_idx];
+            const uint32_t row_begin = neighbors_.offsets[row_idx], row_end = neighbors_.offsets[row_idx + 1];
+
+            // Every row closer than the last neighbor of the graph is in the graph, so the neighbors in the subset
+            // below that distance are exact, ties included; all of them are when the graph holds every row.
+            const bool is_complete = (row_end - row_begin) + 1 >= dataset_.size();
+            const float max_dist = (row_end > row_begin) ? neighbors_.dists[row_end - 1] : 0.f;
+            query_neighbors.clear();
+            for(uint32_t edge_idx = row_begin; edge_idx < row_end; edge_idx++){
+                const uint32_t nn_idx = subset_idxes[neighbors_.idxes[edge_idx]];
+                if(nn_idx != not_in_subset && (is_complete || neighbors_.dists[edge_idx] < max_dist)){
+                    query_neighbors.emplace_back(neighbors_.dists[edge_idx], nn_idx);
+                }
+            }
+
+            if(query_neighbors.size() >= k){
+                // ties of the graph are ordered by row, those of the subset by its own index
+                std::partial_sort(query_neighbors.begin(), query_neighbors.begin() + k, query_neighbors.end());
+                query_neighbors.resize(k);
+            }
+            else{ // too many neighbors were held out, scan the subset
+                query_neighbors.clear();
+                for(uint32_t data_idx = 0; data_idx < n_data; data_idx++){
+                    if(data_idx != query_idx){
+                        PushNeighbor(query_neighbors, k, {EuclideanDistance(dataset_[row_idx], dataset_[row_idxes[data_idx]]), data_idx});
+                    }
+                }
+                std::sort_heap(query_neighbors.begin(), query_neighbors.end());
+            }
+
+            for(uint32_t rank = 0; rank < k; rank++){
+                neighbors.dists[neighbors.offsets[query_idx] + rank] = query_neighbors[rank].first;
+                neighbors.idxes[neighbors.offsets[query_idx] + rank] = query_neighbors[rank].second;
+            }
+        }
+    });
+
+    return neighbors;
+}
+
+float ComputeRecall(const NeighborLists &approx, const NeighborLists &exact)
+{
+    uint64_t n_found = 0, n_exact = 0;
+    for(uint32_t query_idx = 0; query_idx + 1 < exact.offsets.size(); query_idx++){
+        const uint32_t k = exact.GetNumNeighbors(query_idx);
+        if(k == 0){
+            continue;
+        }
+
+        const float max_dist = exact.dists[exact.offsets[query_idx] + k - 1];
+        for(uint32_t rank = 0; rank < std::min(k, approx.GetNumNeighbors(query_idx)); rank++){
+            n_found += (approx.dists[approx.offsets[query_idx] + rank] <= max_dist);
+        }
+        n_exact += k;
+    }
+
+    return (n_exact > 0) ? (float)n_found / n_exact : 1.f;
+}
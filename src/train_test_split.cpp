@@ -14,10 +14,10 @@ static std::vector<uint32_t> CalculateClassCounts(const std::vector<std::vector<
     return class_counts;
 }
 
-void TrainTestSplit(const std::vector<std::vector<float>>&dataset, const float split_ratio,  std::vector<std::vector<float>> &training_set, std::vector<std::vector<float>> &testing_set, const uint32_t n_classes)
+static std::vector<std::vector<uint32_t>> GroupDataIdxesByClass(const std::vector<std::vector<float>> &dataset, const uint32_t n_classes)
 {
     const uint32_t label_idx = dataset[0].size() - 1;
-    std::vector<uint32_t> data_idxes_by_class[n_classes + 1];
+    std::vector<std::vector<uint32_t>> data_idxes_by_class(n_classes + 1);
     
     std::vector<uint32_t> class_counts = CalculateClassCounts(dataset, n_classes);
     for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
@@ -29,6 +29,21 @@ void TrainTestSplit(const std::vector<std::vector<float>>&dataset, const float s
         data_idxes_by_class[label].push_back(data_idx);
     }
 
+    return data_idxes_by_class;
+}
+
+void GatherData(const std::vector<std::vector<float>> &dataset, const std::vector<uint32_t> &idxes, std::vector<std::vector<float>> &subset)
+{
+    subset.reserve(subset.size() + idxes.size());
+    for(uint32_t idx = 0; idx < idxes.size(); idx++){
+        subset.push_back(dataset[idxes[idx]]);
+    }
+}
+
+void TrainTestSplitIdxes(const std::vector<std::vector<float>> &dataset, const float split_ratio, std::vector<uint32_t> &training_idxes, std::vector<uint32_t> &testing_idxes, const uint32_t n_classes)
+{
+    std::vector<std::vector<uint32_t>> data_idxes_by_class = GroupDataIdxesByClass(dataset, n_classes);
+
     std::vector<bool> is_training(dataset.size(), true);
     std::vector<bool> is_testing(dataset.size(), false);
     for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
@@ -43,44 +58,41 @@ void TrainTestSplit(const std::vector<std::vector<float>>&dataset, const float s
         for(uint32_t shuffle_data_idx = 0; shuffle_data_idx < n_testing_data; shuffle_data_idx++){
             uint32_t data_idx = data_idxes_by_class[class_idx][shuffle_data_idx];    
             is_testing[data_idx] = true;
-            if(data_idxes_by_class[class_idx].size() > 1){
+            if(data_idxes_by_class[class_idx].size() > 1){ // a single-instance class stays in both sets
                 is_training[data_idx] = false;
             }
         }
-
     }
 
-    training_set.reserve(dataset.size() * split_ratio);
-    testing_set.reserve(dataset.size() * (1.f - split_ratio));
-    for(int data_idx = dataset.size() - 1; data_idx >= 0; data_idx--){
+    // Ascending row order
+    training_idxes.clear();
+    testing_idxes.clear();
+    training_idxes.reserve(dataset.size() * split_ratio);
+    testing_idxes.reserve(dataset.size() * (1.f - split_ratio));
+    for(uint32_t data_idx = 0; data_idx < dataset.size(); data_idx++){
         if(is_training[data_idx]){
-            training_set.push_back(dataset[data_idx]);
+            training_idxes.push_back(data_idx);
         }
 
         if(is_testing[data_idx]){
-            testing_set.push_back(dataset[data_idx]);
+            testing_idxes.push_back(data_idx);
         }
     }
 }
 
-void KFoldSplit(const std::vector<std::vector<float>>& dataset, const uint32_t n_classes, const uint32_t k, std::vector<std::vector<std::vector<float>>> &training_set, std::vector<std::vector<std::vector<float>>> &testing_set)
+void KFoldSplitIdxes(const std::vector<std::vector<float>> &dataset, const uint32_t n_classes, const uint32_t k, KFoldIdxes &folds)
 {
-    const uint32_t label_idx = dataset[0].size() - 1;
-    std::vector<uint32_t> data_idxes_by_class[n_classes + 1];
-    
-    std::vector<uint32_t> class_counts = CalculateClassCounts(dataset, n_classes);
-    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
-        data_idxes_by_class[class_idx].reserve(class_counts[class_idx]);
-    }
-    
-    for(uint32_t data_idx = 0; data_idx < dataset.size(); data_idx++){
-        uint32_t label = dataset[data_idx][label_idx];
-        data_idxes_by_class[label].push_back(data_idx);
+    std::vector<std::vector<uint32_t>> data_idxes_by_class = GroupDataIdxesByClass(dataset, n_classes);
+
+    folds.k = k;
+    folds.shuffled_idxes.clear();
+    folds.shuffled_idxes.reserve(dataset.size());
+    folds.held_out_fold.assign(dataset.size(), k);
+    folds.testing_idxes.assign(k, std::vector<uint32_t>());
+    for(uint32_t fold_idx = 0; fold_idx < k; fold_idx++){
+        folds.testing_idxes[fold_idx].reserve(dataset.size() / k + n_classes);
     }
 
-    training_set.resize(k);
-    testing_set.resize(k);
-
     std::random_device rd;
     uint64_t time_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
     uint64_t seed = time_seed ^ (rd() << 1);
@@ -91,29 +103,117 @@ void KFoldSplit(const std::vector<std::vector<float>>& dataset, const uint32_t n
 
         for(uint32_t shuffle_data_idx = 0; shuffle_data_idx < data_idxes_by_class[class_idx].size(); shuffle_data_idx++){          
             uint32_t data_idx = data_idxes_by_class[class_idx][shuffle_data_idx]; 
+            folds.shuffled_idxes.push_back(data_idx);
 
-            uint32_t current_fold = 0;
-            if(data_idxes_by_class[class_idx].size() <= 1){
-                current_fold = k; // push into all folds
-            }
-            else{
-                current_fold = shuffle_data_idx % k;
-            }
-            
-            for(uint32_t fold_idx = 0; fold_idx < k; fold_idx++){
-                if(fold_idx != current_fold){
-                    training_set[fold_idx].push_back(dataset[data_idx]);
-                }
+            if(data_idxes_by_class[class_idx].size() > 1){ // a single-instance class is trained in all folds
+                uint32_t current_fold = shuffle_data_idx % k;
+                folds.held_out_fold[data_idx] = current_fold;
+                folds.testing_idxes[current_fold].push_back(data_idx);
             }
-            testing_set[current_fold].push_back(dataset[data_idx]);
         }
-        if(data_idxes_by_class[class_idx].size() < k){
+
+        // Classes smaller than k are repeated so that every fold tests each class; a single-instance class is held
+        // out of no fold, so it is repeated from fold 0
+        if(data_idxes_by_class[class_idx].size() < k && data_idxes_by_class[class_idx].size() > 0){
             uint32_t shuffle_data_idx = 0;
-            for(uint32_t fold_idx = data_idxes_by_class[class_idx].size(); fold_idx < k; fold_idx++){
+            uint32_t first_fold_idx = (data_idxes_by_class[class_idx].size() > 1) ? data_idxes_by_class[class_idx].size() : 0;
+            for(uint32_t fold_idx = first_fold_idx; fold_idx < k; fold_idx++){
                 uint32_t data_idx = data_idxes_by_class[class_idx][shuffle_data_idx]; 
-                testing_set[fold_idx].push_back(dataset[data_idx]);
+                folds.testing_idxes[fold_idx].push_back(data_idx);
                 shuffle_data_idx = (shuffle_data_idx + 1) % data_idxes_by_class[class_idx].size();
             }
         }
     }
 }
+
+void StratifiedSubsampleIdxes(const std::vector<std::vector<float>> &dataset, const uint32_t sample_size, std::vector<uint32_t> &idxes, const uint32_t n_classes)
+{
+    idxes.clear();
+    if(dataset.size() <= sample_size){
+        idxes.resize(dataset.size());
+        for(uint32_t data_idx = 0; data_idx < dataset.size(); data_idx++){
+            idxes[data_idx] = data_idx;
+        }
+        return;
+    }
+
+    std::vector<std::vector<uint32_t>> data_idxes_by_class = GroupDataIdxesByClass(dataset, n_classes);
+
+    std::random_device rd;
+    uint64_t time_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::default_random_engine gen(time_seed ^ (rd() << 1));
+    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+        std::vector<uint32_t> &class_idxes = data_idxes_by_class[class_idx];
+        uint32_t n_sampled_data = ceil((double)class_idxes.size() * sample_size / dataset.size());
+
+        // partial Fisher-Yates shuffle, the first n_sampled_data rows are the sample
+        for(uint32_t sample_idx = 0; sample_idx < n_sampled_data; sample_idx++){
+            std::uniform_int_distribution<uint32_t> distrib(sample_idx, class_idxes.size() - 1);
+            std::swap(class_idxes[sample_idx], class_idxes[distrib(gen)]);
+        }
+        idxes.insert(idxes.end(), class_idxes.begin(), class_idxes.begin() + n_sampled_data);
+    }
+    std::sort(idxes.begin(), idxes.end());
+}
+
+void StratifiedBootstrapIdxes(const std::vector<std::vector<float>> &dataset, const uint32_t sample_size, std::vector<uint32_t> &idxes, const uint32_t n_classes)
+{
+    std::vector<std::vector<uint32_t>> data_idxes_by_class = GroupDataIdxesByClass(dataset, n_classes);
+
+    std::random_device rd;
+    uint64_t time_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    std::default_random_engine gen(time_seed ^ (rd() << 1));
+    idxes.clear();
+    for(uint32_t class_idx = 1; class_idx <= n_classes; class_idx++){
+        const std::vector<uint32_t> &class_idxes = data_idxes_by_class[class_idx];
+        if(class_idxes.empty()){
+            continue;
+        }
+
+        uint32_t n_sampled_data = ceil((double)class_idxes.size() * sample_size / dataset.size());
+        std::uniform_int_distribution<uint32_t> distrib(0, class_idxes.size() - 1);
+        for(uint32_t sample_idx = 0; sample_idx < n_sampled_data; sample_idx++){
+            idxes.push_back(class_idxes[distrib(gen)]);
+        }
+    }
+    std::sort(idxes.begin(), idxes.end());
+}
+
+std::vector<uint32_t> GetTrainingIdxes(const KFoldIdxes &folds, const uint32_t fold_idx)
+{
+    std::vector<uint32_t> training_idxes;
+    training_idxes.reserve(folds.shuffled_idxes.size());
+    for(uint32_t idx = 0; idx < folds.shuffled_idxes.size(); idx++){
+        uint32_t data_idx = folds.shuffled_idxes[idx];
+        if(folds.held_out_fold[data_idx] != fold_idx){
+            training_idxes.push_back(data_idx);
+        }
+    }
+
+    return training_idxes;
+}
+
+void TrainTestSplit(const std::vector<std::vector<float>>&dataset, const float split_ratio,  std::vector<std::vector<float>> &training_set, std::vector<std::vector<float>> &testing_set, const uint32_t n_classes)
+{
+    std::vector<uint32_t> training_idxes, testing_idxes;
+    TrainTestSplitIdxes(dataset, split_ratio, training_idxes, testing_idxes, n_classes);
+
+    // Legacy callers receive the rows in descending row order
+    std::reverse(training_idxes.begin(), training_idxes.end());
+    std::reverse(testing_idxes.begin(), testing_idxes.end());
+    GatherData(dataset, training_idxes, training_set);
+    GatherData(dataset, testing_idxes, testing_set);
+}
+
+void KFoldSplit(const std::vector<std::vector<float>>& dataset, const uint32_t n_classes, const uint32_t k, std::vector<std::vector<std::vector<float>>> &training_set, std::vector<std::vector<std::vector<float>>> &testing_set)
+{
+    KFoldIdxes folds;
+    KFoldSplitIdxes(dataset, n_classes, k, folds);
+
+    training_set.resize(k);
+    testing_set.resize(k);
+    for(uint32_t fold_idx = 0; fold_idx < k; fold_idx++){
+        GatherData(dataset, GetTrainingIdxes(folds, fold_idx), training_set[fold_idx]);
+        GatherData(dataset, folds.testing_idxes[fold_idx], testing_set[fold_idx]);
+    }
+}
@@ -0,0 +1,63 @@
+#include "../inc/weighted_sampler.h"
+
+WeightedSampler::WeightedSampler(const std::vector<float> &weights)
+                    :n_positive_(0), top_step_(1), weights_(weights), tree_(weights.size() + 1, 0.)
+{
+    // every node adds itself to its parent once, so the tree is built in O(N)
+    for(uint32_t node = 1; node <= weights_.size(); node++){
+        tree_[node] += weights_[node - 1];
+        const uint32_t parent = node + (node & -node);
+        if(parent <= weights_.size()){
+            tree_[parent] += tree_[node];
+        }
+        n_positive_ += (weights_[node - 1] > 0.f);
+    }
+
+    while(top_step_ * 2 <= weights_.size()){
+        top_step_ *= 2;
+    }
+}
+
+double WeightedSampler::GetTotal(void) const
+{
+    if(n_positive_ == 0){
+        return 0.;
+    }
+
+    double total = 0.;
+    for(uint32_t node = weights_.size(); node > 0; node -= node & -node){
+        total += tree_[node];
+    }
+
+    return total;
+}
+
+uint32_t WeightedSampler::Sample(std::mt19937 &gen) const
+{
+    std::uniform_real_distribution<> distrib(0., GetTotal());
+    double random_value = distrib(gen);
+
+    // descend to the last node whose prefix sum stays below random_value; the next index is selected
+    uint32_t node = 0;
+    for(uint32_t step = top_step_; step > 0; step /= 2){
+        if(node + step <= weights_.size() && tree_[node + step] < random_value){
+            node += step;
+            random_value -= tree_[node];
+        }
+    }
+
+    return (node < weights_.size()) ? node : weights_.size() - 1; // the last index in case of rounding errors
+}
+
+void WeightedSampler::Remove(const uint32_t idx)
+{
+    if(weights_[idx] <= 0.f){
+        return;
+    }
+
+    for(uint32_t node = idx + 1; node <= weights_.size(); node += node & -node){
+        tree_[node] -= weights_[idx];
+    }
+    weights_[idx] = 0.f;
+    n_positive_--;
+}